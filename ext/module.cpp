@@ -9,6 +9,7 @@ namespace py = pybind11;
 namespace revkit
 {
 
+void flat_array( py::module m );
 void qubit( py::module m );
 void gate( py::module m );
 void netlist( py::module m );
@@ -21,6 +22,7 @@ void synthesis( py::module m );
 
 PYBIND11_MODULE( _revkit, m )
 {
+  revkit::flat_array( m );
   revkit::qubit( m );
   revkit::gate( m );
   revkit::netlist( m );
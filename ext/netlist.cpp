@@ -1,9 +1,17 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#include <caterpillar/verification/simulate_circuit.hpp>
 #include <tweedledum/gates/mcst_gate.hpp>
+#include <tweedledum/io/binary.hpp>
 #include <tweedledum/io/qasm.hpp>
 #include <tweedledum/io/quil.hpp>
 #include <tweedledum/io/write_unicode.hpp>
@@ -65,10 +73,275 @@ void gate( py::module m )
     .export_values();
 }
 
+template<typename T>
+void _flat_array( py::module m, char const* name, char const* doc )
+{
+  py::class_<flat_array_t<T>>( m, name, doc, py::buffer_protocol() )
+    .def_buffer( []( flat_array_t<T>& ref ) -> py::buffer_info {
+      return py::buffer_info( ref.data.data(), sizeof( T ), py::format_descriptor<T>::format(), 1,
+                              {static_cast<py::ssize_t>( ref.data.size() )}, {static_cast<py::ssize_t>( sizeof( T ) )} );
+    } )
+    .def( "__len__", []( flat_array_t<T> const& ref ) { return ref.data.size(); } )
+    .def( "__getitem__", []( flat_array_t<T> const& ref, std::size_t index ) {
+      if ( index >= ref.data.size() )
+      {
+        throw py::index_error();
+      }
+      return ref.data[index];
+    } );
+}
+
+void flat_array( py::module m )
+{
+  _flat_array<uint8_t>( m, "uint8_array", "Contiguous array of 8-bit unsigned integers (supports the buffer protocol)" );
+  _flat_array<uint32_t>( m, "uint32_array", "Contiguous array of 32-bit unsigned integers (supports the buffer protocol)" );
+  _flat_array<double>( m, "float_array", "Contiguous array of double precision floats (supports the buffer protocol)" );
+}
+
+/* circuit lowered into instructions with positive controls and a single
+   target, the qubits of an instruction are its controls followed by its
+   target */
+struct _instruction_table
+{
+  flat_array_t<uint8_t> ops;
+  flat_array_t<uint32_t> qubit_offsets{{0u}};
+  flat_array_t<uint32_t> qubits;
+  flat_array_t<double> params;
+
+  void add( tweedledum::gate_set op, std::initializer_list<uint32_t> qs, double param = 0.0 )
+  {
+    add( op, qs.begin(), qs.end(), param );
+  }
+
+  template<typename Iterator>
+  void add( tweedledum::gate_set op, Iterator begin, Iterator end, double param = 0.0 )
+  {
+    ops.data.push_back( static_cast<uint8_t>( op ) );
+    qubits.data.insert( qubits.data.end(), begin, end );
+    qubit_offsets.data.push_back( static_cast<uint32_t>( qubits.data.size() ) );
+    params.data.push_back( param );
+  }
+};
+
+/* negative controls are resolved by inverting the control qubit before and
+   after the gate, and for multiple targets of a gate with at least two
+   controls, the first target is copied to the other targets with CNOTs */
+inline void _lower_gate( gate_t const& g, _instruction_table& table )
+{
+  using tweedledum::gate_set;
+
+  std::vector<uint32_t> qubits; /* controls followed by target */
+  std::vector<uint32_t> negated, targets;
+  g.foreach_control( [&]( auto q ) {
+    qubits.push_back( q.index() );
+    if ( q.is_complemented() )
+    {
+      negated.push_back( q.index() );
+    }
+  } );
+  g.foreach_target( [&]( auto q ) { targets.push_back( q.index() ); } );
+  const auto num_controls = qubits.size();
+  const auto invert_controls = [&]() {
+    for ( auto q : negated )
+    {
+      table.add( gate_set::pauli_x, {q} );
+    }
+  };
+
+  switch ( g.operation() )
+  {
+  default:
+    throw std::runtime_error( fmt::format( "unsupported gate type {}", static_cast<uint32_t>( g.operation() ) ) );
+
+  case gate_set::identity:
+    break;
+
+  case gate_set::hadamard:
+  case gate_set::pauli_x:
+  case gate_set::pauli_y:
+  case gate_set::pauli_z:
+  case gate_set::phase:
+  case gate_set::phase_dagger:
+  case gate_set::t:
+  case gate_set::t_dagger:
+    for ( auto t : targets )
+    {
+      table.add( g.operation(), {t} );
+    }
+    break;
+
+  case gate_set::rotation_x:
+  case gate_set::rotation_y:
+  case gate_set::rotation_z:
+    for ( auto t : targets )
+    {
+      table.add( g.operation(), {t}, g.rotation_angle().numeric_value() );
+    }
+    break;
+
+  case gate_set::swap:
+    table.add( gate_set::cx, {targets[0], targets[1]} );
+    table.add( gate_set::cx, {targets[1], targets[0]} );
+    table.add( gate_set::cx, {targets[0], targets[1]} );
+    break;
+
+  case gate_set::cx:
+  case gate_set::cz:
+  case gate_set::mcx:
+  case gate_set::mcz:
+  {
+    const auto is_z = g.operation() == gate_set::cz || g.operation() == gate_set::mcz;
+    invert_controls();
+    if ( num_controls <= 1u )
+    {
+      const auto op = num_controls == 0u ? ( is_z ? gate_set::pauli_z : gate_set::pauli_x ) : ( is_z ? gate_set::cz : gate_set::cx );
+      for ( auto t : targets )
+      {
+        qubits.push_back( t );
+        table.add( op, qubits.begin(), qubits.end() );
+        qubits.pop_back();
+      }
+    }
+    else
+    {
+      /* X on all targets is an X on the first target fanned out to the other ones, and Z on all
+         targets is a Z on the parity of all targets, which is computed into the first target */
+      const auto combine_targets = [&]() {
+        for ( auto i = 1u; i < targets.size(); ++i )
+        {
+          if ( is_z )
+          {
+            table.add( gate_set::cx, {targets[i], targets[0]} );
+          }
+          else
+          {
+            table.add( gate_set::cx, {targets[0], targets[i]} );
+          }
+        }
+      };
+      combine_targets();
+      qubits.push_back( targets[0] );
+      if ( is_z )
+      {
+        table.add( gate_set::hadamard, {targets[0]} );
+      }
+      table.add( gate_set::mcx, qubits.begin(), qubits.end() );
+      if ( is_z )
+      {
+        table.add( gate_set::hadamard, {targets[0]} );
+      }
+      combine_targets();
+    }
+    invert_controls();
+  }
+  break;
+  }
+}
+
+/* raises an exception if a qubit index is out of range, or if an input qubit occurs more than once */
+inline void _check_simulation_qubits( netlist_t const& circ, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs )
+{
+  std::vector<bool> is_input( circ.num_qubits() );
+  for ( auto q : inputs )
+  {
+    if ( q >= circ.num_qubits() )
+    {
+      throw py::index_error( fmt::format( "input qubit {} out of range for circuit with {} qubits", q, circ.num_qubits() ) );
+    }
+    if ( is_input[q] )
+    {
+      throw py::value_error( fmt::format( "input qubit {} occurs more than once", q ) );
+    }
+    is_input[q] = true;
+  }
+  for ( auto q : outputs )
+  {
+    if ( q >= circ.num_qubits() )
+    {
+      throw py::index_error( fmt::format( "output qubit {} out of range for circuit with {} qubits", q, circ.num_qubits() ) );
+    }
+  }
+}
+
+/* produces the OPENQASM or Quil code of a circuit in chunks, a chunk holds
+   all gates that are formatted until it has at least `chunk_size` characters */
+class _code_chunks
+{
+public:
+  _code_chunks( netlist_t const& circ, bool quil, std::size_t chunk_size )
+      : _circ( circ ),
+        _quil( quil ),
+        _chunk_size( std::max<std::size_t>( chunk_size, 1u ) ),
+        _node( 0u )
+  {
+  }
+
+  /* returns false, if all code has been produced */
+  bool next( std::string& chunk )
+  {
+    /* input nodes of qubits that are added after some gates (e.g., ancillae) are stored in
+       between the gates, hence all nodes are visited and input nodes are skipped below */
+    const auto num_nodes = _circ.num_qubits() + _circ.num_gates();
+
+    fmt::memory_buffer buffer;
+    if ( !_quil && !_header_written )
+    {
+      tweedledum::detail::write_qasm_header( _circ.num_qubits(), buffer );
+      _header_written = true;
+    }
+    for ( ; _node < num_nodes && buffer.size() < _chunk_size; ++_node )
+    {
+      auto const& node = _circ.get_node( netlist_t::node_ptr_type( _node ) );
+      if ( !node.gate.is_unitary_gate() )
+      {
+        continue;
+      }
+      if ( _quil )
+      {
+        tweedledum::detail::write_quil_gate( node.gate, buffer );
+      }
+      else
+      {
+        tweedledum::detail::write_qasm_gate( node.gate, buffer );
+      }
+    }
+
+    if ( buffer.size() == 0u )
+    {
+      return false;
+    }
+    chunk.assign( buffer.data(), buffer.size() );
+    return true;
+  }
+
+private:
+  netlist_t _circ; /* shares the storage with the Python object */
+  bool _quil;
+  std::size_t _chunk_size;
+  uint32_t _node;
+  bool _header_written{false};
+};
+
 void netlist( py::module m )
 {
   using namespace py::literals;
 
+  py::class_<_code_chunks>( m, "_code_chunks", "Iterator over chunks of code of a circuit" )
+    .def( "__iter__", []( _code_chunks& ref ) -> _code_chunks& { return ref; } )
+    .def( "__next__", []( _code_chunks& ref ) {
+      std::string chunk;
+      bool has_next;
+      {
+        py::gil_scoped_release release;
+        has_next = ref.next( chunk );
+      }
+      if ( !has_next )
+      {
+        throw py::stop_iteration();
+      }
+      return chunk;
+    } );
+
   py::class_<netlist_t> _netlist( m, "netlist", "Quantum circuit data structure" );
   _netlist.def_property_readonly( "num_gates", &netlist_t::num_gates, "Number of quantum gates in circuit" );
   _netlist.def_property_readonly( "num_qubits", &netlist_t::num_qubits, "Number of qubits in circuit" );
@@ -82,6 +355,196 @@ void netlist( py::module m )
     :rtype: List[gate]
 )doc" );
 
+  _netlist.def( "gate_arrays", []( netlist_t const& ref ) {
+    flat_array_t<uint8_t> kinds, complemented;
+    flat_array_t<uint32_t> control_offsets, controls, target_offsets, targets;
+    flat_array_t<double> angles;
+
+    kinds.data.reserve( ref.num_gates() );
+    angles.data.reserve( ref.num_gates() );
+    control_offsets.data.reserve( ref.num_gates() + 1u );
+    target_offsets.data.reserve( ref.num_gates() + 1u );
+    control_offsets.data.push_back( 0u );
+    target_offsets.data.push_back( 0u );
+
+    ref.foreach_cgate( [&]( auto const& n ) {
+      auto const& g = n.gate;
+      kinds.data.push_back( static_cast<uint8_t>( g.operation() ) );
+      angles.data.push_back( g.is_meta() ? 0.0 : g.rotation_angle().numeric_value() );
+      g.foreach_control( [&]( auto q ) {
+        controls.data.push_back( q.index() );
+        complemented.data.push_back( q.is_complemented() ? 1u : 0u );
+      } );
+      g.foreach_target( [&]( auto q ) { targets.data.push_back( q.index() ); } );
+      control_offsets.data.push_back( static_cast<uint32_t>( controls.data.size() ) );
+      target_offsets.data.push_back( static_cast<uint32_t>( targets.data.size() ) );
+    } );
+
+    py::dict arrays;
+    arrays["kinds"] = py::cast( std::move( kinds ) );
+    arrays["control_offsets"] = py::cast( std::move( control_offsets ) );
+    arrays["controls"] = py::cast( std::move( controls ) );
+    arrays["complemented"] = py::cast( std::move( complemented ) );
+    arrays["target_offsets"] = py::cast( std::move( target_offsets ) );
+    arrays["targets"] = py::cast( std::move( targets ) );
+    arrays["angles"] = py::cast( std::move( angles ) );
+    return arrays;
+  }, R"doc(
+    Gates as flat contiguous arrays
+
+    Returns a dictionary of arrays that support the buffer protocol, e.g., they
+    can be wrapped without copying using ``numpy.asarray`` or ``memoryview``.
+    Controls and targets are stored in CSR form: the controls of the `i`-th
+    gate are ``controls[control_offsets[i]:control_offsets[i + 1]]`` and
+    likewise for targets.
+
+    - ``kinds``: gate kind of each gate (value of :class:`gate.gate_type`)
+    - ``control_offsets``, ``target_offsets``: offsets into ``controls`` and ``targets``
+    - ``controls``, ``targets``: qubit indexes
+    - ``complemented``: 1 for each control with negative polarity, 0 otherwise
+    - ``angles``: rotation angle of each gate
+
+    :rtype: Dict[str, uint8_array | uint32_array | float_array]
+)doc" );
+
+  _netlist.def( "instructions", []( netlist_t const& ref ) {
+    _instruction_table table;
+    {
+      py::gil_scoped_release release;
+      table.ops.data.reserve( ref.num_gates() );
+      table.params.data.reserve( ref.num_gates() );
+      table.qubit_offsets.data.reserve( ref.num_gates() + 1u );
+      ref.foreach_cgate( [&]( auto const& n ) { _lower_gate( n.gate, table ); } );
+    }
+
+    py::dict arrays;
+    arrays["ops"] = py::cast( std::move( table.ops ) );
+    arrays["qubit_offsets"] = py::cast( std::move( table.qubit_offsets ) );
+    arrays["qubits"] = py::cast( std::move( table.qubits ) );
+    arrays["params"] = py::cast( std::move( table.params ) );
+    return arrays;
+  }, R"doc(
+    Circuit lowered into a table of simple instructions
+
+    Every gate is lowered into instructions on a single target and with
+    positive controls only: negative controls are inverted with X gates before
+    and after the gate, gates with several targets are applied to each target
+    (or, if they have at least two controls, are applied to the first target,
+    which is fanned out with CNOT gates for X, and holds the parity of all
+    targets for Z), and SWAP gates are lowered into three CNOT gates.  The
+    operation of an instruction is one of the single-qubit gates, ``cx``,
+    ``cz``, or ``mcx``, for which the last qubit is the target.
+
+    The table is returned as a dictionary of arrays that support the buffer
+    protocol (see :func:`netlist.gate_arrays`):
+
+    - ``ops``: operation of each instruction (value of :class:`gate.gate_type`)
+    - ``qubit_offsets``: the qubits of the `i`-th instruction are
+      ``qubits[qubit_offsets[i]:qubit_offsets[i + 1]]``
+    - ``qubits``: qubit indexes, controls followed by the target
+    - ``params``: rotation angle of each instruction (0 for other instructions)
+
+    :rtype: Dict[str, uint8_array | uint32_array | float_array]
+)doc" );
+
+  _netlist.def( "simulate", []( netlist_t const& ref, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs, uint32_t num_threads ) {
+    if ( inputs.size() > 32u )
+    {
+      throw std::runtime_error( "exhaustive simulation is limited to 32 inputs, use simulate_random" );
+    }
+    _check_simulation_qubits( ref, inputs, outputs );
+    const auto tts = caterpillar::simulate_circuit_exhaustive( ref, inputs, outputs, num_threads );
+    if ( !tts )
+    {
+      throw std::runtime_error( "circuit contains gates other than X, CX, MCX, and SWAP" );
+    }
+    return *tts;
+  }, R"doc(
+    Simulate reversible circuit for all input assignments
+
+    Returns the function of each output qubit as a truth table over the input
+    qubits, where the first input qubit is the least significant variable.
+    All other qubits are initialized to 0.  The circuit may only contain X,
+    CX, MCX, and SWAP gates.  Gates are applied to 2048 input patterns at a
+    time with word operations, and blocks of patterns are distributed over
+    ``num_threads`` threads (0 means hardware concurrency).  Raises
+    ``IndexError`` for qubits that are not in the circuit, and ``ValueError``
+    if an input qubit occurs more than once.
+
+    :param List[int] inputs: Input qubits
+    :param List[int] outputs: Output qubits
+    :param int num_threads: Number of threads
+    :rtype: List[truth_table]
+)doc", "inputs"_a, "outputs"_a, "num_threads"_a = 1u, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "simulate_random", []( netlist_t const& ref, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs, uint32_t num_vars, uint64_t seed, uint32_t num_threads ) {
+    _check_simulation_qubits( ref, inputs, outputs );
+    auto result = caterpillar::simulate_circuit_random( ref, inputs, outputs, num_vars, seed, num_threads );
+    if ( !result )
+    {
+      throw std::runtime_error( "circuit contains gates other than X, CX, MCX, and SWAP" );
+    }
+    return *result;
+  }, R"doc(
+    Simulate reversible circuit for random input assignments
+
+    Simulates ``2 ** num_vars`` random input patterns and returns a pair of
+    lists of truth tables over ``num_vars`` variables: the patterns of each
+    input qubit and the simulated values of each output qubit, where bit
+    `j` of each truth table belongs to the `j`-th pattern.  The patterns
+    only depend on ``seed``, such that the results of two circuits can be
+    compared.  Otherwise, it behaves like :func:`netlist.simulate`.
+
+    :param List[int] inputs: Input qubits
+    :param List[int] outputs: Output qubits
+    :param int num_vars: Logarithm of the number of patterns
+    :param int seed: Random seed
+    :param int num_threads: Number of threads
+    :rtype: Tuple[List[truth_table], List[truth_table]]
+)doc", "inputs"_a, "outputs"_a, "num_vars"_a = 16u, "seed"_a = 0u, "num_threads"_a = 1u, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "to_permutation", []( netlist_t const& ref, uint32_t num_threads ) {
+    if ( ref.num_qubits() > 32u )
+    {
+      throw std::runtime_error( "permutations are limited to 32 qubits" );
+    }
+    const auto permutation = caterpillar::circuit_to_permutation( ref, num_threads );
+    if ( !permutation )
+    {
+      throw std::runtime_error( "circuit contains gates other than X, CX, MCX, and SWAP" );
+    }
+    return *permutation;
+  }, R"doc(
+    Permutation of basis states implemented by reversible circuit
+
+    Entry `j` is the basis state after applying the circuit to basis state
+    `j`, where qubit 0 is the least significant bit.  All basis states are
+    simulated in parallel with word operations (see :func:`netlist.simulate`).
+
+    :param int num_threads: Number of threads
+    :rtype: List[int]
+)doc", "num_threads"_a = 1u, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "implements_permutation", []( netlist_t const& ref, std::vector<uint32_t> const& permutation, uint32_t num_threads ) {
+    const auto result = caterpillar::circuit_implements_permutation( ref, permutation, num_threads );
+    if ( !result )
+    {
+      throw std::runtime_error( "circuit contains gates other than X, CX, MCX, and SWAP" );
+    }
+    return *result;
+  }, R"doc(
+    Check whether reversible circuit implements a permutation
+
+    Same as comparing :func:`netlist.to_permutation` to ``permutation``, but
+    without constructing the permutation of the circuit, and the simulation
+    stops at the first mismatch.  Returns ``False``, if the size of the
+    permutation is not ``2 ** num_qubits``.
+
+    :param List[int] permutation: Permutation of basis states
+    :param int num_threads: Number of threads
+    :rtype: bool
+)doc", "permutation"_a, "num_threads"_a = 1u, py::call_guard<py::gil_scoped_release>() );
+
   _netlist.def( "to_quil", []( netlist_t const& ref ) {
     std::ostringstream s;
     tweedledum::write_quil( ref, s );
@@ -94,6 +557,114 @@ void netlist( py::module m )
     return s.str();
   }, "Write circuit to QASM code" );
 
+  _netlist.def( "write_quil", []( netlist_t const& ref, std::string const& filename ) {
+    tweedledum::write_quil( ref, filename );
+  }, R"doc(
+    Write circuit to a file as QUIL code
+
+    Same as :func:`netlist.to_quil`, but the code is written into the file in
+    chunks instead of being collected in a string.
+
+    :param str filename: Filename
+)doc", "filename"_a, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "write_qasm", []( netlist_t const& ref, std::string const& filename ) {
+    tweedledum::write_qasm( ref, filename );
+  }, R"doc(
+    Write circuit to a file as QASM code
+
+    Same as :func:`netlist.to_qasm`, but the code is written into the file in
+    chunks instead of being collected in a string.
+
+    :param str filename: Filename
+)doc", "filename"_a, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "iter_quil", []( netlist_t const& ref, std::size_t chunk_size ) {
+    return _code_chunks( ref, true, chunk_size );
+  }, R"doc(
+    Iterate over QUIL code of circuit in chunks
+
+    Each chunk is a string of complete instructions with at least
+    ``chunk_size`` characters (except for the last one).  Concatenating all
+    chunks gives the same code as :func:`netlist.to_quil`.  Chunks are
+    formatted on demand, such that the memory usage does not depend on the
+    size of the circuit.
+
+    :param int chunk_size: Minimum number of characters in a chunk
+    :rtype: Iterator[str]
+)doc", "chunk_size"_a = 1u << 20 );
+
+  _netlist.def( "iter_qasm", []( netlist_t const& ref, std::size_t chunk_size ) {
+    return _code_chunks( ref, false, chunk_size );
+  }, R"doc(
+    Iterate over QASM code of circuit in chunks
+
+    Each chunk is a string of complete statements with at least
+    ``chunk_size`` characters (except for the last one).  Concatenating all
+    chunks gives the same code as :func:`netlist.to_qasm`.  Chunks are
+    formatted on demand, such that the memory usage does not depend on the
+    size of the circuit.
+
+    :param int chunk_size: Minimum number of characters in a chunk
+    :rtype: Iterator[str]
+)doc", "chunk_size"_a = 1u << 20 );
+
+  _netlist.def_static( "from_qasm", []( std::string const& program ) {
+    netlist_t circ;
+    tweedledum::read_qasm_from_buffer( circ, program.data(), program.size() );
+    return circ;
+  }, R"doc(
+    Read circuit from OPENQASM 2.0 code
+
+    Supports register declarations and the gates of ``qelib1.inc`` that have a
+    counterpart in :class:`gate.gate_type`, including register broadcasting.
+    ``creg``, ``barrier``, and ``measure`` statements are ignored.  Raises a
+    ``RuntimeError`` with the line number if the program cannot be read.
+
+    :param str program: OPENQASM 2.0 code
+    :rtype: netlist
+)doc", "program"_a, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def_static( "load_qasm", []( std::string const& filename ) {
+    netlist_t circ;
+    tweedledum::read_qasm( circ, filename );
+    return circ;
+  }, R"doc(
+    Read circuit from an OPENQASM 2.0 file
+
+    Same as :func:`netlist.from_qasm`, but the file is memory mapped and read
+    without copying it into a string.
+
+    :param str filename: Filename
+    :rtype: netlist
+)doc", "filename"_a, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def( "save", []( netlist_t const& ref, std::string const& filename ) {
+    tweedledum::write_binary( ref, filename );
+  }, R"doc(
+    Save circuit to a binary file
+
+    The binary format stores gates as fixed-width records and can be read back
+    with :func:`netlist.load`.  It preserves qubit labels, rotation angles, and
+    control polarities.
+
+    :param str filename: Filename
+)doc", "filename"_a, py::call_guard<py::gil_scoped_release>() );
+
+  _netlist.def_static( "load", []( std::string const& filename ) {
+    netlist_t circ;
+    tweedledum::read_binary( circ, filename );
+    return circ;
+  }, R"doc(
+    Load circuit from a binary file
+
+    Reads a file that has been written with :func:`netlist.save`.  The file
+    is memory mapped and gates are decoded while they are added to the circuit.
+
+    :param str filename: Filename
+    :rtype: netlist
+)doc", "filename"_a, py::call_guard<py::gil_scoped_release>() );
+
   _netlist.def( "to_unicode", []( netlist_t const& ref, bool fancy ) { 
     std::ostringstream s;
     tweedledum::write_unicode( ref, fancy, s );
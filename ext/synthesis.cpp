@@ -3,16 +3,25 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <functional>
+#include <istream>
 #include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <caterpillar/synthesis/lhrs.hpp>
 #include <caterpillar/synthesis/strategies/eager_mapping_strategy.hpp>
 #include <caterpillar/synthesis/strategies/bennett_mapping_strategy.hpp>
 #include <caterpillar/synthesis/strategies/pebbling_mapping_strategy.hpp>
+#include <easy/esop/esop_from_pkrm.hpp>
 #include <lorina/aiger.hpp>
 #include <lorina/bench.hpp>
 #include <lorina/verilog.hpp>
@@ -28,7 +37,14 @@
 #include <tweedledum/algorithms/synthesis/diagonal_synth.hpp>
 #include <tweedledum/algorithms/synthesis/gray_synth.hpp>
 #include <tweedledum/algorithms/synthesis/stg.hpp>
+#include <tweedledum/algorithms/synthesis/stg_cache.hpp>
 #include <tweedledum/algorithms/synthesis/tbs.hpp>
+#include <tweedledum/io/binary.hpp>
+#include <tweedledum/io/qasm.hpp>
+#include <tweedledum/io/quil.hpp>
+#include <tweedledum/networks/gate_sink.hpp>
+#include <tweedledum/utils/dynamic_bitset.hpp>
+#include <tweedledum/utils/parallel_for.hpp>
 
 #include "types.hpp"
 
@@ -37,6 +53,29 @@ namespace py = pybind11;
 namespace revkit
 {
 
+enum class oracle_synth_type
+{
+  pkrm,
+  pprm,
+  spectrum
+};
+
+enum class lhrs_network_type
+{
+  aig,
+  xag,
+  mig,
+  xmg,
+  klut
+};
+
+enum class logic_network_format
+{
+  verilog,
+  aiger,
+  bench
+};
+
 enum class mapping_strategy_type
 {
   bennett,
@@ -45,6 +84,13 @@ enum class mapping_strategy_type
   pebbling
 };
 
+enum class circuit_format
+{
+  qasm,
+  quil,
+  binary
+};
+
 std::string _filename_extension( const std::string& filename )
 {
 
@@ -57,47 +103,331 @@ std::string _filename_extension( const std::string& filename )
   return std::string();
 }
 
-using lut_synthesis_t = std::function<void( netlist_t&, std::vector<tweedledum::qubit_id> const&, kitty::dynamic_truth_table const& )>;
+netlist_t _oracle_synth( truth_table_t const& function, oracle_synth_type kind )
+{
+  netlist_t circ;
+  for ( auto i = 0u; i < function.num_vars() + 1u; ++i )
+  {
+    circ.add_qubit();
+  }
+  std::vector<tweedledum::qubit_id> qubits( function.num_vars() + 1u );
+  std::iota( qubits.begin(), qubits.end(), 0u );
 
-template<class LogicNetwork>
-std::pair<netlist_t, std::unordered_map<std::string, std::vector<uint32_t>>>
-_lhrs_wrapper( std::string const& filename, mapping_strategy_type strategy_type, lut_synthesis_t const& lut_synthesis, uint32_t num_pebbles )
+  switch ( kind )
+  {
+  default:
+  case oracle_synth_type::spectrum:
+    tweedledum::stg_from_spectrum()( circ, qubits, function );
+    break;
+  case oracle_synth_type::pkrm:
+    tweedledum::stg_from_pkrm()( circ, qubits, function );
+    break;
+  case oracle_synth_type::pprm:
+    tweedledum::stg_from_pprm()( circ, qubits, function );
+    break;
+  }
+
+  return circ;
+}
+
+netlist_t _dbs( std::vector<uint32_t> const& perm, oracle_synth_type kind )
 {
-  LogicNetwork ntk;
+  switch ( kind )
+  {
+  default:
+  case oracle_synth_type::spectrum:
+    return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_spectrum() );
+  case oracle_synth_type::pkrm:
+    return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_pkrm() );
+  case oracle_synth_type::pprm:
+    return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_pprm() );
+  }
+}
 
-  auto ext = _filename_extension( filename );
-  std::transform( ext.begin(), ext.end(), ext.begin(), ::tolower );
+/* internal function for gray_synth, parse( index, add_variable ) calls add_variable( i ) for each
+ * variable i in the index-th parity term and returns the term's angle */
+template<typename Term, typename Parse>
+netlist_t _gray_synth( uint32_t num_vars, std::size_t num_terms, Parse&& parse )
+{
+  std::vector<std::pair<Term, tweedledum::angle>> parity_terms;
+  parity_terms.reserve( num_terms );
+  for ( auto index = 0u; index < num_terms; ++index )
+  {
+    Term term = [&]() {
+      if constexpr ( std::is_integral_v<Term> )
+      {
+        return Term( 0u );
+      }
+      else
+      {
+        return Term( num_vars );
+      }
+    }();
+    double const angle = parse( index, [&]( uint32_t var ) {
+      if ( var >= num_vars )
+      {
+        throw std::runtime_error( fmt::format( "parity term {} has more than {} variables", index, num_vars ) );
+      }
+      if constexpr ( std::is_integral_v<Term> )
+      {
+        term |= Term( 1u ) << var;
+      }
+      else
+      {
+        term[var] = 1;
+      }
+    } );
+    if ( angle != 0.0 )
+    {
+      parity_terms.emplace_back( std::move( term ), tweedledum::angle( angle ) );
+    }
+  }
 
-  if ( ext == "v" )
+  tweedledum::parity_terms<Term> parities;
+  parities.add_terms( parity_terms.begin(), parity_terms.end() );
+  return tweedledum::gray_synth<netlist_t>( num_vars, parities );
+}
+
+/* picks the smallest parity term type that can represent num_vars variables */
+template<typename Parse>
+netlist_t _gray_synth( uint32_t num_vars, std::size_t num_terms, Parse&& parse )
+{
+  if ( num_vars <= 32u )
   {
-    if constexpr ( !std::is_same_v<LogicNetwork, mockturtle::klut_network> )
+    return _gray_synth<uint32_t>( num_vars, num_terms, parse );
+  }
+  if ( num_vars <= 64u )
+  {
+    return _gray_synth<uint64_t>( num_vars, num_terms, parse );
+  }
+  return _gray_synth<tweedledum::dynamic_bitset<uint64_t>>( num_vars, num_terms, parse );
+}
+
+/* removes the byte order character from a buffer format, only native byte order is supported */
+std::string _buffer_format( py::buffer_info const& info )
+{
+  auto format = info.format;
+  if ( !format.empty() && ( format[0] == '@' || format[0] == '=' || format[0] == '<' ) )
+  {
+    format.erase( 0, 1 );
+  }
+  return format;
+}
+
+netlist_t _gray_synth_from_buffers( py::buffer_info const& terms, py::buffer_info const& angles, uint32_t num_vars )
+{
+  auto const terms_format = _buffer_format( terms );
+  auto const angles_format = _buffer_format( angles );
+  bool const is_bool = terms_format == "?";
+  if ( ( !is_bool && ( terms_format.size() != 1u || std::string( "bBhHiIlLqQ" ).find( terms_format[0] ) == std::string::npos ) ) || terms.itemsize > 8 )
+  {
+    throw std::runtime_error( fmt::format( "parity terms must be an integer or boolean array, not of format '{}'", terms.format ) );
+  }
+  if ( angles_format != "d" && angles_format != "f" )
+  {
+    throw std::runtime_error( fmt::format( "angles must be a float array, not of format '{}'", angles.format ) );
+  }
+  if ( ( terms.ndim != 1 && terms.ndim != 2 ) || angles.ndim != 1 || terms.shape[0] != angles.shape[0] )
+  {
+    throw std::runtime_error( "parity terms must be a 1D or 2D array with one row per angle" );
+  }
+
+  auto const num_words = terms.ndim == 1 ? py::ssize_t( 1 ) : terms.shape[1];
+  auto const word_stride = terms.ndim == 1 ? py::ssize_t( 0 ) : terms.strides[1];
+  uint32_t const bits_per_word = is_bool ? 1u : 8u * static_cast<uint32_t>( terms.itemsize );
+
+  return _gray_synth( num_vars, static_cast<std::size_t>( terms.shape[0] ), [&]( auto index, auto&& add_variable ) {
+    auto const* row = static_cast<char const*>( terms.ptr ) + index * terms.strides[0];
+    for ( py::ssize_t w = 0; w < num_words; ++w )
     {
-      lorina::read_verilog( filename, mockturtle::verilog_reader( ntk ) );
+      auto const* ptr = row + w * word_stride;
+      uint64_t word{0u};
+      switch ( terms.itemsize )
+      {
+      case 1: word = *reinterpret_cast<uint8_t const*>( ptr ); break;
+      case 2: { uint16_t value; std::memcpy( &value, ptr, 2u ); word = value; } break;
+      case 4: { uint32_t value; std::memcpy( &value, ptr, 4u ); word = value; } break;
+      case 8: std::memcpy( &word, ptr, 8u ); break;
+      }
+      if ( is_bool )
+      {
+        word = word != 0u;
+      }
+      for ( ; word; word &= word - 1u )
+      {
+        add_variable( w * bits_per_word + static_cast<uint32_t>( __builtin_ctzll( word ) ) );
+      }
     }
-    else
+
+    auto const* angle = static_cast<char const*>( angles.ptr ) + index * angles.strides[0];
+    if ( angles_format == "f" )
     {
-      throw "unsupported network type for Verilog files";
+      float value;
+      std::memcpy( &value, angle, sizeof( float ) );
+      return static_cast<double>( value );
+    }
+    double value;
+    std::memcpy( &value, angle, sizeof( double ) );
+    return value;
+  } );
+}
+
+/* applies fn to all elements in inputs in parallel, with the GIL released */
+template<typename Input, typename Fn>
+std::vector<netlist_t> _synthesis_batch( std::vector<Input> const& inputs, uint32_t num_threads, Fn&& fn )
+{
+  std::vector<netlist_t> circs( inputs.size() );
+
+  py::gil_scoped_release release;
+  tweedledum::parallel_for( static_cast<uint32_t>( inputs.size() ), [&]( uint32_t i ) {
+    circs[i] = fn( inputs[i] );
+  }, num_threads );
+
+  return circs;
+}
+
+/* whether the bytes of a buffer are stored in order, without gaps, starting at its pointer */
+bool _is_c_contiguous( py::buffer_info const& info )
+{
+  auto stride = info.itemsize;
+  for ( auto i = info.ndim; i-- > 0; )
+  {
+    if ( info.shape[i] != 1 && info.strides[i] != stride )
+    {
+      return false;
     }
+    stride *= info.shape[i];
   }
-  else if ( ext == "aig" )
+  return true;
+}
+
+/* read-only stream buffer over memory owned by someone else */
+class _memory_streambuf : public std::streambuf
+{
+public:
+  _memory_streambuf( char const* data, std::size_t size )
   {
-    lorina::read_aiger( filename, mockturtle::aiger_reader( ntk ) );
+    auto begin = const_cast<char*>( data );
+    setg( begin, begin, begin + size );
   }
-  else if ( ext == "bench" )
+};
+
+/* output stream buffer that passes chunks of data to a Python callable, the GIL is only
+   acquired once per chunk */
+class _callback_streambuf : public std::streambuf
+{
+public:
+  explicit _callback_streambuf( py::function const& callback, std::size_t chunk_size = 1u << 20 )
+      : _callback( callback ),
+        _buffer( chunk_size )
+  {
+    setp( _buffer.data(), _buffer.data() + _buffer.size() );
+  }
+
+protected:
+  int_type overflow( int_type ch ) override
+  {
+    flush_chunk();
+    if ( !traits_type::eq_int_type( ch, traits_type::eof() ) )
+    {
+      *pptr() = traits_type::to_char_type( ch );
+      pbump( 1 );
+    }
+    return traits_type::not_eof( ch );
+  }
+
+  int sync() override
+  {
+    flush_chunk();
+    return 0;
+  }
+
+private:
+  void flush_chunk()
+  {
+    if ( pptr() != pbase() )
+    {
+      py::gil_scoped_acquire acquire;
+      _callback( py::bytes( pbase(), static_cast<std::size_t>( pptr() - pbase() ) ) );
+    }
+    setp( _buffer.data(), _buffer.data() + _buffer.size() );
+  }
+
+private:
+  py::function const& _callback;
+  std::vector<char> _buffer;
+};
+
+template<class LogicNetwork>
+void _read_logic_network( std::istream& in, logic_network_format format, LogicNetwork& ntk )
+{
+  switch ( format )
   {
+  case logic_network_format::verilog:
+    if constexpr ( !std::is_same_v<LogicNetwork, mockturtle::klut_network> )
+    {
+      lorina::read_verilog( in, mockturtle::verilog_reader( ntk ) );
+    }
+    else
+    {
+      throw "unsupported network type for Verilog files";
+    }
+    break;
+  case logic_network_format::aiger:
+    lorina::read_aiger( in, mockturtle::aiger_reader( ntk ) );
+    break;
+  case logic_network_format::bench:
     if constexpr ( std::is_same_v<LogicNetwork, mockturtle::klut_network> )
     {
-      lorina::read_bench( filename, mockturtle::bench_reader( ntk ) );
+      lorina::read_bench( in, mockturtle::bench_reader( ntk ) );
     }
     else
     {
       throw "unsupported network type for BENCH files";
     }
+    break;
+  }
+}
+
+logic_network_format _format_from_filename( std::string const& filename )
+{
+  auto ext = _filename_extension( filename );
+  std::transform( ext.begin(), ext.end(), ext.begin(), ::tolower );
+
+  if ( ext == "v" )
+  {
+    return logic_network_format::verilog;
+  }
+  else if ( ext == "aig" )
+  {
+    return logic_network_format::aiger;
+  }
+  else if ( ext == "bench" )
+  {
+    return logic_network_format::bench;
   }
   else
   {
     throw "unknown file extension: " + ext;
   }
+}
+
+using _lhrs_stats_t = std::unordered_map<std::string, std::vector<uint32_t>>;
+
+caterpillar::pebbling_mapping_strategy_params _pebbling_params( uint32_t num_pebbles, uint32_t num_threads, double time_limit )
+{
+  caterpillar::pebbling_mapping_strategy_params ps;
+  ps.pebble_limit = num_pebbles;
+  ps.num_threads = num_threads;
+  ps.time_limit = time_limit;
+  return ps;
+}
+
+template<class LogicNetwork, class QuantumNetwork, class LutSynthesisFn>
+_lhrs_stats_t _lhrs_wrapper( QuantumNetwork& circ, std::istream& in, logic_network_format format, mapping_strategy_type strategy_type, LutSynthesisFn const& lut_synthesis, caterpillar::pebbling_mapping_strategy_params const& pebbling_ps, uint32_t num_threads )
+{
+  LogicNetwork ntk;
+  _read_logic_network( in, format, ntk );
 
   auto strategy = [&]() -> std::shared_ptr<caterpillar::mapping_strategy<LogicNetwork>> {
     switch ( strategy_type )
@@ -109,23 +439,148 @@ _lhrs_wrapper( std::string const& filename, mapping_strategy_type strategy_type,
         return std::make_shared<caterpillar::bennett_mapping_strategy<LogicNetwork>>();
       case mapping_strategy_type::eager:
         return std::make_shared<caterpillar::eager_mapping_strategy<LogicNetwork>>();
-      case mapping_strategy_type::pebbling: {
-        caterpillar::pebbling_mapping_strategy_params ps;
-        ps.pebble_limit = num_pebbles;
-        return std::make_shared<caterpillar::pebbling_mapping_strategy<LogicNetwork>>( ps );
-      }
+      case mapping_strategy_type::pebbling:
+        return std::make_shared<caterpillar::pebbling_mapping_strategy<LogicNetwork>>( pebbling_ps );
     }
   }();
 
-  netlist_t circ;
+  caterpillar::logic_network_synthesis_params ps;
   caterpillar::logic_network_synthesis_stats st;
-  caterpillar::logic_network_synthesis( circ, ntk, *strategy, lut_synthesis, {}, &st );
+  ps.num_threads = num_threads;
+  caterpillar::logic_network_synthesis( circ, ntk, *strategy, lut_synthesis, ps, &st );
 
-  std::unordered_map<std::string, std::vector<uint32_t>> stats;
+  _lhrs_stats_t stats;
   stats["input_indexes"] = st.i_indexes;
   stats["output_indexes"] = st.o_indexes;
+  return stats;
+}
 
-  return std::make_pair( circ, stats );
+template<class QuantumNetwork>
+_lhrs_stats_t _lhrs( QuantumNetwork& circ, std::istream& in, logic_network_format format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, caterpillar::pebbling_mapping_strategy_params const& pebbling_ps, uint32_t num_threads, bool cache_luts )
+{
+  /* the LUT synthesis function is passed with its type, such that LUTs are synthesized directly
+   * into circ, unless they are synthesized in parallel or cached */
+  const auto synthesize = [&]( auto const& lut_synthesis_fn ) {
+    switch ( network_type )
+    {
+    case lhrs_network_type::aig:
+      return _lhrs_wrapper<mockturtle::aig_network>( circ, in, format, strategy, lut_synthesis_fn, pebbling_ps, num_threads );
+    default:
+    case lhrs_network_type::xag:
+      return _lhrs_wrapper<mockturtle::xag_network>( circ, in, format, strategy, lut_synthesis_fn, pebbling_ps, num_threads );
+    case lhrs_network_type::mig:
+      return _lhrs_wrapper<mockturtle::mig_network>( circ, in, format, strategy, lut_synthesis_fn, pebbling_ps, num_threads );
+    case lhrs_network_type::xmg:
+      return _lhrs_wrapper<mockturtle::xmg_network>( circ, in, format, strategy, lut_synthesis_fn, pebbling_ps, num_threads );
+    case lhrs_network_type::klut:
+      return _lhrs_wrapper<mockturtle::klut_network>( circ, in, format, strategy, lut_synthesis_fn, pebbling_ps, num_threads );
+    }
+  };
+
+  const auto synthesize_with = [&]( auto stg_fn ) {
+    if ( cache_luts )
+    {
+      tweedledum::stg_cache<decltype( stg_fn )> cache( stg_fn );
+      auto stats = synthesize( cache );
+      const auto st = cache.stats();
+      stats["stg_cache_hits"] = {static_cast<uint32_t>( st.hits )};
+      stats["stg_cache_misses"] = {static_cast<uint32_t>( st.misses )};
+      return stats;
+    }
+    return synthesize( stg_fn );
+  };
+
+  switch ( lut_synthesis )
+  {
+  default:
+  case oracle_synth_type::spectrum:
+    return synthesize_with( tweedledum::stg_from_spectrum{} );
+  case oracle_synth_type::pprm:
+    return synthesize_with( tweedledum::stg_from_pprm{} );
+  case oracle_synth_type::pkrm:
+    if ( cache_luts )
+    {
+      /* PKRM expansions of small sub-functions are shared among the LUTs of this run */
+      easy::esop::pkrm_expansion_cache expansion_cache;
+      tweedledum::stg_from_pkrm_params pkrm_ps;
+      pkrm_ps.expansion_cache = &expansion_cache;
+      auto stats = synthesize_with( tweedledum::stg_from_pkrm( pkrm_ps ) );
+      const auto st = expansion_cache.stats();
+      stats["pkrm_cache_hits"] = {static_cast<uint32_t>( st.hits )};
+      stats["pkrm_cache_misses"] = {static_cast<uint32_t>( st.misses )};
+      stats["pkrm_cache_evictions"] = {static_cast<uint32_t>( st.evictions )};
+      return stats;
+    }
+    return synthesize_with( tweedledum::stg_from_pkrm{} );
+  }
+}
+
+/* LHRS into a new circuit */
+std::pair<netlist_t, _lhrs_stats_t>
+_lhrs( std::istream& in, logic_network_format format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, caterpillar::pebbling_mapping_strategy_params const& pebbling_ps, uint32_t num_threads, bool cache_luts )
+{
+  netlist_t circ;
+  auto stats = _lhrs( circ, in, format, network_type, strategy, lut_synthesis, pebbling_ps, num_threads, cache_luts );
+  return std::make_pair( std::move( circ ), std::move( stats ) );
+}
+
+template<class Writer>
+_lhrs_stats_t _lhrs_to_writer( Writer& writer, std::istream& in, logic_network_format format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, caterpillar::pebbling_mapping_strategy_params const& pebbling_ps, uint32_t num_threads, bool cache_luts )
+{
+  tweedledum::gate_sink<Writer> sink( writer );
+  auto stats = _lhrs( sink, in, format, network_type, strategy, lut_synthesis, pebbling_ps, num_threads, cache_luts );
+  if constexpr ( std::is_same_v<Writer, tweedledum::binary_writer> )
+  {
+    writer.set_rewiring_map( sink.rewire_map() );
+  }
+  writer.finish();
+  return stats;
+}
+
+/* opens a logic network file, raises an error if it cannot be opened */
+std::ifstream _open_logic_network( std::string const& filename )
+{
+  std::ifstream in( lorina::detail::word_exp_filename( filename ), std::ifstream::in );
+  if ( !in )
+  {
+    throw std::runtime_error( "cannot open file '" + filename + "'" );
+  }
+  return in;
+}
+
+/* LHRS that writes gates into an output stream as soon as they are synthesized */
+_lhrs_stats_t _lhrs_stream( std::string const& filename, std::ostream& os, circuit_format output_format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, caterpillar::pebbling_mapping_strategy_params const& pebbling_ps, uint32_t num_threads, bool cache_luts )
+{
+  const auto format = _format_from_filename( filename );
+  auto in = _open_logic_network( filename );
+  if ( !os )
+  {
+    throw std::runtime_error( "cannot write to output stream" );
+  }
+
+  /* errors in the output (including exceptions raised in a Python callback) abort synthesis */
+  os.exceptions( std::ostream::badbit | std::ostream::failbit );
+
+  auto stats = [&]() {
+    switch ( output_format )
+    {
+    default:
+    case circuit_format::qasm: {
+      tweedledum::qasm_stream_writer writer( os );
+      return _lhrs_to_writer( writer, in, format, network_type, strategy, lut_synthesis, pebbling_ps, num_threads, cache_luts );
+    }
+    case circuit_format::quil: {
+      tweedledum::quil_stream_writer writer( os );
+      return _lhrs_to_writer( writer, in, format, network_type, strategy, lut_synthesis, pebbling_ps, num_threads, cache_luts );
+    }
+    case circuit_format::binary: {
+      tweedledum::binary_writer writer( os );
+      return _lhrs_to_writer( writer, in, format, network_type, strategy, lut_synthesis, pebbling_ps, num_threads, cache_luts );
+    }
+    }
+  }();
+  os.flush();
+  return stats;
 }
 
 void synthesis( py::module m )
@@ -133,32 +588,61 @@ void synthesis( py::module m )
   using namespace py::literals;
 
   m.def(
-      "gray_synth", []( py::args parity_terms ) {
-        uint32_t num_vars = 0u;
+      "gray_synth", []( py::buffer terms, py::buffer angles, uint32_t num_vars ) {
+        auto const terms_info = terms.request();
+        auto const angles_info = angles.request();
+
+        py::gil_scoped_release release;
+        return _gray_synth_from_buffers( terms_info, angles_info, num_vars );
+      },
+      R"doc(
+    GraySynth synthesis algorithm for parity terms in arrays
+
+    This variant avoids converting each parity term in Python, and is the one
+    to use for large phase polynomials.  Both arrays are read through the
+    buffer protocol (e.g., NumPy arrays) without copying them.
+
+    :param buffer terms: Parity terms, one per row.  Either a 2D boolean array
+        with one column per variable, or an array of unsigned integers, in which
+        bit ``i`` of a row (across its words for a 2D array) is 1 if the
+        ``i``-th qubit is contained in the parity term.
+    :param buffer angles: 1D float array with one angle per parity term
+    :param int num_vars: Number of qubits
+    :rtype: netlist
+
+    The following example synthesizes a controlled S operation::
 
-        tweedledum::parity_terms parities;
+        import numpy as np
+        from revkit import gray_synth
+        from math import pi
+
+        circ = gray_synth(np.array([0b10, 0b01, 0b11], dtype=np.uint32),
+                          np.array([pi / 4, pi / 4, -pi / 4]), 2)
+)doc", "terms"_a, "angles"_a, "num_vars"_a );
+
+  m.def(
+      "gray_synth", []( py::args parity_terms ) {
+        std::vector<std::pair<std::string, double>> terms;
+        terms.reserve( parity_terms.size() );
         for ( auto const& entry : parity_terms )
         {
           auto const& tuple = entry.cast<py::tuple>();
-          std::string term = tuple[0].cast<py::str>();
-          double angle = tuple[1].cast<py::float_>();
-
-          if ( num_vars == 0u )
-          {
-            num_vars = term.size();
-          }
+          terms.emplace_back( tuple[0].cast<std::string>(), tuple[1].cast<double>() );
+        }
+        uint32_t const num_vars = terms.empty() ? 0u : static_cast<uint32_t>( terms.front().first.size() );
 
-          uint32_t iterm{0u};
+        py::gil_scoped_release release;
+        return _gray_synth( num_vars, terms.size(), [&]( auto index, auto&& add_variable ) {
+          auto const& [term, angle] = terms[index];
           for ( auto i = 0u; i < term.size(); ++i )
           {
             if ( term[i] == '1' )
             {
-              iterm |= 1 << i;
+              add_variable( i );
             }
           }
-          parities.add_term( iterm, tweedledum::angle( angle ) );
-        }
-        return tweedledum::gray_synth<netlist_t>( num_vars, parities );
+          return angle;
+        } );
       },
       R"doc(
     GraySynth synthesis algorithm for parity terms
@@ -167,7 +651,8 @@ void synthesis( py::module m )
         The first entry of the term is a bitstring where the first bit
         corresponds to the first qubit and is 1 if it is contained in the parity
         term. The second parameter is the angle that should be applied for this
-        term.
+        term.  The number of qubits is the length of the first bitstring, no
+        bitstring may be longer; there is no limit on the number of qubits.
     :rtype: netlist
 
     The following example synthesizes a controlled S operation::
@@ -180,13 +665,6 @@ void synthesis( py::module m )
     .. seealso:: `tweedledum documentation for gray_synth <https://tweedledum.readthedocs.io/en/latest/algorithms/synthesis/gray_synth.html>`_
 )doc" );
 
-  enum class oracle_synth_type
-  {
-    pkrm,
-    pprm,
-    spectrum
-  };
-
   py::enum_<oracle_synth_type>( m, "oracle_synth_type", "Oracle synthesis kind enumeration" )
       .value( "pkrm", oracle_synth_type::pkrm )
       .value( "pprm", oracle_synth_type::pprm )
@@ -194,31 +672,7 @@ void synthesis( py::module m )
       .export_values();
 
   m.def(
-      "oracle_synth", []( truth_table_t const& function, oracle_synth_type kind ) {
-        netlist_t circ;
-        for ( auto i = 0u; i < function.num_vars() + 1u; ++i )
-        {
-          circ.add_qubit();
-        }
-        std::vector<tweedledum::qubit_id> qubits( function.num_vars() + 1u );
-        std::iota( qubits.begin(), qubits.end(), 0u );
-
-        switch ( kind )
-        {
-        default:
-        case oracle_synth_type::spectrum:
-          tweedledum::stg_from_spectrum()( circ, qubits, function );
-          break;
-        case oracle_synth_type::pkrm:
-          tweedledum::stg_from_pkrm()( circ, qubits, function );
-          break;
-        case oracle_synth_type::pprm:
-          tweedledum::stg_from_pprm()( circ, qubits, function );
-          break;
-        }
-
-        return circ;
-      },
+      "oracle_synth", &_oracle_synth,
       R"doc(
     Oracle synthesis
 
@@ -229,10 +683,28 @@ void synthesis( py::module m )
     :param oracle_synth_type kind: Synthesis type
     :rtype: netlist
 )doc",
-      "function"_a, "kind"_a = oracle_synth_type::spectrum );
+      "function"_a, "kind"_a = oracle_synth_type::spectrum, py::call_guard<py::gil_scoped_release>() );
+
+  m.def(
+      "oracle_synth_batch", []( std::vector<truth_table_t> const& functions, oracle_synth_type kind, uint32_t num_threads ) {
+        return _synthesis_batch( functions, num_threads, [&]( auto const& function ) { return _oracle_synth( function, kind ); } );
+      },
+      R"doc(
+    Oracle synthesis for many functions
+
+    Runs :func:`oracle_synth` for each function in parallel.  The GIL is
+    released during synthesis.
+
+    :param List[truth_table] functions: Oracle functions
+    :param oracle_synth_type kind: Synthesis type
+    :param int num_threads: Number of threads (0 uses all hardware threads)
+    :rtype: List[netlist]
+)doc",
+      "functions"_a, "kind"_a = oracle_synth_type::spectrum, "num_threads"_a = 0u );
 
   m.def(
       "diagonal_synth", [&]( std::vector<double> const& angles ) {
+        py::gil_scoped_release release;
         return tweedledum::diagonal_synth<netlist_t>( angles );
       },
       R"doc(
@@ -249,18 +721,7 @@ void synthesis( py::module m )
 )doc" );
 
   m.def(
-      "dbs", []( std::vector<uint32_t> const& perm, oracle_synth_type kind ) {
-        switch ( kind )
-        {
-        default:
-        case oracle_synth_type::spectrum:
-          return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_spectrum() );
-        case oracle_synth_type::pkrm:
-          return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_pkrm() );
-        case oracle_synth_type::pprm:
-          return tweedledum::dbs<netlist_t>( perm, tweedledum::stg_from_pprm() );
-        }
-      },
+      "dbs", &_dbs,
       R"doc(
     Decomposition-based synthesis
 
@@ -270,7 +731,24 @@ void synthesis( py::module m )
 
     .. seealso:: `tweedledum documentation for dbs <https://tweedledum.readthedocs.io/en/latest/algorithms/synthesis/dbs.html>`_
 )doc",
-      "perm"_a, "kind"_a = oracle_synth_type::spectrum );
+      "perm"_a, "kind"_a = oracle_synth_type::spectrum, py::call_guard<py::gil_scoped_release>() );
+
+  m.def(
+      "dbs_batch", []( std::vector<std::vector<uint32_t>> const& perms, oracle_synth_type kind, uint32_t num_threads ) {
+        return _synthesis_batch( perms, num_threads, [&]( auto const& perm ) { return _dbs( perm, kind ); } );
+      },
+      R"doc(
+    Decomposition-based synthesis for many permutations
+
+    Runs :func:`dbs` for each permutation in parallel.  The GIL is released
+    during synthesis.
+
+    :param List[List[int]] perms: Permutations
+    :param oracle_synth_type kind: Synthesis type
+    :param int num_threads: Number of threads (0 uses all hardware threads)
+    :rtype: List[netlist]
+)doc",
+      "perms"_a, "kind"_a = oracle_synth_type::spectrum, "num_threads"_a = 0u );
 
   m.def(
       "tbs", []( std::vector<uint32_t> const& perm ) { return tweedledum::tbs<netlist_t>( perm ); }, R"doc(
@@ -281,16 +759,23 @@ void synthesis( py::module m )
 
     .. seealso:: `tweedledum documentation for tbs <https://tweedledum.readthedocs.io/en/latest/algorithms/synthesis/tbs.html>`_
 )doc",
-      "perm"_a );
+      "perm"_a, py::call_guard<py::gil_scoped_release>() );
 
-  enum class lhrs_network_type
-  {
-    aig,
-    xag,
-    mig,
-    xmg,
-    klut
-  };
+  m.def(
+      "tbs_batch", []( std::vector<std::vector<uint32_t>> const& perms, uint32_t num_threads ) {
+        return _synthesis_batch( perms, num_threads, []( auto const& perm ) { return tweedledum::tbs<netlist_t>( perm ); } );
+      },
+      R"doc(
+    Transformation based synthesis for many permutations
+
+    Runs :func:`tbs` for each permutation in parallel.  The GIL is released
+    during synthesis.
+
+    :param List[List[int]] perms: Permutations
+    :param int num_threads: Number of threads (0 uses all hardware threads)
+    :rtype: List[netlist]
+)doc",
+      "perms"_a, "num_threads"_a = 0u );
 
   py::enum_<lhrs_network_type>( m, "lhrs_network_type", "LHRS base logic network type" )
       .value( "aig", lhrs_network_type::aig )
@@ -307,35 +792,19 @@ void synthesis( py::module m )
       .value( "pebbling", mapping_strategy_type::pebbling )
       .export_values();
 
+  py::enum_<logic_network_format>( m, "logic_network_format", "Logic network file format" )
+      .value( "verilog", logic_network_format::verilog )
+      .value( "aiger", logic_network_format::aiger )
+      .value( "bench", logic_network_format::bench )
+      .export_values();
+
   m.def(
-      "lhrs", []( std::string const& filename, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles ) {
-        const auto lut_synthesis_fn = [&]() {
-          switch ( lut_synthesis )
-          {
-          default:
-          case oracle_synth_type::spectrum:
-            return lut_synthesis_t( tweedledum::stg_from_spectrum{} );
-          case oracle_synth_type::pprm:
-            return lut_synthesis_t( tweedledum::stg_from_pprm{} );
-          case oracle_synth_type::pkrm:
-            return lut_synthesis_t( tweedledum::stg_from_pkrm{} );
-          }
-        }();
+      "lhrs", []( std::string const& filename, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles, uint32_t num_threads, bool cache_luts, double pebbling_time_limit, uint32_t pebbling_num_threads ) {
+        const auto format = _format_from_filename( filename );
+        auto in = _open_logic_network( filename );
 
-        switch ( network_type )
-        {
-        case lhrs_network_type::aig:
-          return _lhrs_wrapper<mockturtle::aig_network>( filename, strategy, lut_synthesis_fn, num_pebbles );
-        default:
-        case lhrs_network_type::xag:
-          return _lhrs_wrapper<mockturtle::xag_network>( filename, strategy, lut_synthesis_fn, num_pebbles );
-        case lhrs_network_type::mig:
-          return _lhrs_wrapper<mockturtle::mig_network>( filename, strategy, lut_synthesis_fn, num_pebbles );
-        case lhrs_network_type::xmg:
-          return _lhrs_wrapper<mockturtle::xmg_network>( filename, strategy, lut_synthesis_fn, num_pebbles );
-        case lhrs_network_type::klut:
-          return _lhrs_wrapper<mockturtle::klut_network>( filename, strategy, lut_synthesis_fn, num_pebbles );
-        }
+        py::gil_scoped_release release;
+        return _lhrs( in, format, network_type, strategy, lut_synthesis, _pebbling_params( num_pebbles, pebbling_num_threads, pebbling_time_limit ), num_threads, cache_luts );
       }, R"doc(
     LUT-based hierarchical reversible logic synthesis
 
@@ -356,12 +825,136 @@ void synthesis( py::module m )
     | BENCH (``*.bench``) | klut                           |
     +---------------------+--------------------------------+
 
+    With the pebbling strategy and ``pebbling_num_threads`` other than 1,
+    several pebble limits up to ``num_pebbles`` (or the number of gates, if
+    ``num_pebbles`` is 0) are tried concurrently with different SAT solvers,
+    and the solution with the fewest pebbles found within
+    ``pebbling_time_limit`` is used.  ``num_threads`` only affects LUT
+    synthesis.
+
+    :param string filename: Filename to a logic network
+    :param lhrs_network_type network_type: Logic network representation type
+    :param mapping_strategy strategy: Qubit mapping strategy
+    :param oracle_synth_type lut_synthesis: Oracle synthesis method for LUT functions
+    :param int num_pebbles: Maximum number of pebbles (for pebbling strategy)
+    :param int num_threads: Number of threads for LUT synthesis (0 uses all hardware threads)
+    :param bool cache_luts: Reuse LUT circuits for NPN-equivalent functions (and, with PKRM synthesis, share expansions of small sub-functions among LUTs)
+    :param float pebbling_time_limit: Time limit in seconds for the pebbling strategy with more than one pebbling thread (0 means no limit)
+    :param int pebbling_num_threads: Number of threads for the pebbling strategy (0 uses all hardware threads)
+    :rtype: (netlist, dict)
+)doc", "filename"_a, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u, "num_threads"_a = 1u, "cache_luts"_a = false, "pebbling_time_limit"_a = 0.0, "pebbling_num_threads"_a = 1u );
+
+  py::enum_<circuit_format>( m, "circuit_format", "Output format of streamed circuits" )
+      .value( "qasm", circuit_format::qasm )
+      .value( "quil", circuit_format::quil )
+      .value( "binary", circuit_format::binary )
+      .export_values();
+
+  m.def(
+      "lhrs_stream", []( std::string const& filename, std::string const& output, circuit_format output_format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles, uint32_t num_threads, bool cache_luts, double pebbling_time_limit, uint32_t pebbling_num_threads ) {
+        py::gil_scoped_release release;
+        std::ofstream os( output, std::ofstream::out | std::ofstream::binary );
+        if ( !os )
+        {
+          throw std::runtime_error( "cannot open file '" + output + "'" );
+        }
+        return _lhrs_stream( filename, os, output_format, network_type, strategy, lut_synthesis, _pebbling_params( num_pebbles, pebbling_num_threads, pebbling_time_limit ), num_threads, cache_luts );
+      }, R"doc(
+    LUT-based hierarchical reversible logic synthesis into a file or callback
+
+    Like :func:`lhrs`, but gates are written to ``output`` as soon as they are
+    synthesized instead of being stored in a :class:`netlist`.  Hence, the
+    memory usage depends on the size of the logic network, but not on the size
+    of the circuit.  ``output`` is either a filename (which can also be a named
+    pipe) or a callable, which is called with chunks of the output as
+    ``bytes`` objects.  Exceptions raised by the callable abort synthesis.
+
+    In OPENQASM output, every qubit is declared as its own register ``q<i>``,
+    since the number of qubits is only known after synthesis.  Files in binary
+    format can be read with :func:`netlist.load`.
+
     :param string filename: Filename to a logic network
+    :param output: Output filename or callable
+    :type output: str or Callable[[bytes], None]
+    :param circuit_format output_format: Output format
+    :param lhrs_network_type network_type: Logic network representation type
+    :param mapping_strategy strategy: Qubit mapping strategy
+    :param oracle_synth_type lut_synthesis: Oracle synthesis method for LUT functions
+    :param int num_pebbles: Maximum number of pebbles (for pebbling strategy)
+    :param int num_threads: Number of threads for LUT synthesis (0 uses all hardware threads)
+    :param bool cache_luts: Reuse LUT circuits for NPN-equivalent functions (and, with PKRM synthesis, share expansions of small sub-functions among LUTs)
+    :param float pebbling_time_limit: Time limit in seconds for the pebbling strategy with more than one pebbling thread (0 means no limit)
+    :param int pebbling_num_threads: Number of threads for the pebbling strategy (0 uses all hardware threads)
+    :rtype: dict
+)doc", "filename"_a, "output"_a, "output_format"_a = circuit_format::qasm, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u, "num_threads"_a = 1u, "cache_luts"_a = false, "pebbling_time_limit"_a = 0.0, "pebbling_num_threads"_a = 1u );
+
+  m.def(
+      "lhrs_stream", []( std::string const& filename, py::function const& output, circuit_format output_format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles, uint32_t num_threads, bool cache_luts, double pebbling_time_limit, uint32_t pebbling_num_threads ) {
+        py::gil_scoped_release release;
+        _callback_streambuf buf( output );
+        std::ostream os( &buf );
+        return _lhrs_stream( filename, os, output_format, network_type, strategy, lut_synthesis, _pebbling_params( num_pebbles, pebbling_num_threads, pebbling_time_limit ), num_threads, cache_luts );
+      }, "filename"_a, "output"_a, "output_format"_a = circuit_format::qasm, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u, "num_threads"_a = 1u, "cache_luts"_a = false, "pebbling_time_limit"_a = 0.0, "pebbling_num_threads"_a = 1u );
+
+  m.def(
+      "lhrs_from_bytes", []( py::buffer data, logic_network_format format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles, uint32_t num_threads, bool cache_luts, double pebbling_time_limit, uint32_t pebbling_num_threads ) {
+        const auto info = data.request();
+        if ( !_is_c_contiguous( info ) )
+        {
+          throw py::value_error( "data must be a contiguous buffer" );
+        }
+        _memory_streambuf buf( static_cast<char const*>( info.ptr ), static_cast<std::size_t>( info.size * info.itemsize ) );
+        std::istream in( &buf );
+
+        py::gil_scoped_release release;
+        return _lhrs( in, format, network_type, strategy, lut_synthesis, _pebbling_params( num_pebbles, pebbling_num_threads, pebbling_time_limit ), num_threads, cache_luts );
+      }, R"doc(
+    LUT-based hierarchical reversible logic synthesis from memory
+
+    Like :func:`lhrs`, but the logic network is parsed directly from a bytes-like
+    object (e.g., ``bytes``, ``bytearray``, or ``memoryview``) without copying
+    it and without accessing the file system.  The object must be contiguous,
+    otherwise a ``ValueError`` is raised.  This is the variant to use for
+    binary formats such as Aiger.
+
+    :param bytes data: Logic network in the given file format
+    :param logic_network_format format: File format of ``data``
+    :param lhrs_network_type network_type: Logic network representation type
+    :param mapping_strategy strategy: Qubit mapping strategy
+    :param oracle_synth_type lut_synthesis: Oracle synthesis method for LUT functions
+    :param int num_pebbles: Maximum number of pebbles (for pebbling strategy)
+    :param int num_threads: Number of threads for LUT synthesis (0 uses all hardware threads)
+    :param bool cache_luts: Reuse LUT circuits for NPN-equivalent functions (and, with PKRM synthesis, share expansions of small sub-functions among LUTs)
+    :param float pebbling_time_limit: Time limit in seconds for the pebbling strategy with more than one pebbling thread (0 means no limit)
+    :param int pebbling_num_threads: Number of threads for the pebbling strategy (0 uses all hardware threads)
+    :rtype: (netlist, dict)
+)doc", "data"_a, "format"_a, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u, "num_threads"_a = 1u, "cache_luts"_a = false, "pebbling_time_limit"_a = 0.0, "pebbling_num_threads"_a = 1u );
+
+  m.def(
+      "lhrs_from_string", []( std::string const& data, logic_network_format format, lhrs_network_type network_type, mapping_strategy_type strategy, oracle_synth_type lut_synthesis, uint32_t num_pebbles, uint32_t num_threads, bool cache_luts, double pebbling_time_limit, uint32_t pebbling_num_threads ) {
+        _memory_streambuf buf( data.data(), data.size() );
+        std::istream in( &buf );
+
+        py::gil_scoped_release release;
+        return _lhrs( in, format, network_type, strategy, lut_synthesis, _pebbling_params( num_pebbles, pebbling_num_threads, pebbling_time_limit ), num_threads, cache_luts );
+      }, R"doc(
+    LUT-based hierarchical reversible logic synthesis from a string
+
+    Like :func:`lhrs`, but the logic network is parsed from a string, e.g., the
+    contents of a Verilog or BENCH file.
+
+    :param str data: Logic network in the given file format
+    :param logic_network_format format: File format of ``data``
     :param lhrs_network_type network_type: Logic network representation type
     :param mapping_strategy strategy: Qubit mapping strategy
     :param oracle_synth_type lut_synthesis: Oracle synthesis method for LUT functions
+    :param int num_pebbles: Maximum number of pebbles (for pebbling strategy)
+    :param int num_threads: Number of threads for LUT synthesis (0 uses all hardware threads)
+    :param bool cache_luts: Reuse LUT circuits for NPN-equivalent functions (and, with PKRM synthesis, share expansions of small sub-functions among LUTs)
+    :param float pebbling_time_limit: Time limit in seconds for the pebbling strategy with more than one pebbling thread (0 means no limit)
+    :param int pebbling_num_threads: Number of threads for the pebbling strategy (0 uses all hardware threads)
     :rtype: (netlist, dict)
-)doc", "filename"_a, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u );
+)doc", "data"_a, "format"_a, "network_type"_a = lhrs_network_type::xag, "strategy"_a = mapping_strategy_type::bennett_inplace, "lut_synthesis"_a = oracle_synth_type::spectrum, "num_pebbles"_a = 0u, "num_threads"_a = 1u, "cache_luts"_a = false, "pebbling_time_limit"_a = 0.0, "pebbling_num_threads"_a = 1u );
 }
 
 } // namespace revkit
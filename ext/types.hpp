@@ -1,15 +1,31 @@
 #pragma once
 
+#include <caterpillar/compact_stg_gate.hpp>
 #include <caterpillar/stg_gate.hpp>
 #include <kitty/dynamic_truth_table.hpp>
 #include <tweedledum/gates/mcmt_gate.hpp>
 #include <tweedledum/networks/netlist.hpp>
 
+#include <vector>
+
 namespace revkit
 {
 
 using truth_table_t = kitty::dynamic_truth_table;
+/* define REVKIT_COMPACT_NETLIST to store gates in compact_stg_gate, which
+   avoids heap allocations for gates with up to 4 qubits */
+#if defined( REVKIT_COMPACT_NETLIST )
+using netlist_t = tweedledum::netlist<caterpillar::compact_stg_gate>;
+#else
 using netlist_t = tweedledum::netlist<caterpillar::stg_gate>;
+#endif
 using gate_t = netlist_t::gate_type;
 
+/* contiguous array that is exposed to Python through the buffer protocol */
+template<typename T>
+struct flat_array_t
+{
+  std::vector<T> data;
+};
+
 }
@@ -0,0 +1,407 @@
+/*-------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*------------------------------------------------------------------------------------------------*/
+#pragma once
+#include <tweedledum/gates/gate_base.hpp>
+#include <tweedledum/networks/qubit.hpp>
+
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace caterpillar
+{
+
+namespace td = tweedledum;
+
+namespace detail
+{
+
+/* chunk of an append-only arena in which the qubit lists of many gates are
+   stored back to back; a chunk is released together with the last gate (or
+   arena) that refers to it */
+struct qubit_chunk
+{
+  explicit qubit_chunk( uint32_t capacity )
+      : data( new uint32_t[capacity] ),
+        capacity( capacity )
+  {
+  }
+
+  std::atomic<uint32_t> references{1u};
+  std::unique_ptr<uint32_t[]> data;
+  uint32_t size{0u};
+  uint32_t capacity;
+};
+
+inline void retain( qubit_chunk* chunk )
+{
+  chunk->references.fetch_add( 1u, std::memory_order_relaxed );
+}
+
+inline void release( qubit_chunk* chunk )
+{
+  if ( chunk->references.fetch_sub( 1u, std::memory_order_acq_rel ) == 1u )
+  {
+    delete chunk;
+  }
+}
+
+/* every thread appends to its own chunk, therefore no locking is required */
+class qubit_arena
+{
+public:
+  static constexpr uint32_t chunk_capacity = 1u << 14;
+
+  qubit_arena() = default;
+  qubit_arena( qubit_arena const& ) = delete;
+  qubit_arena& operator=( qubit_arena const& ) = delete;
+
+  ~qubit_arena()
+  {
+    if ( _current )
+    {
+      release( _current );
+    }
+  }
+
+  /* reserves space for `size` literals, the returned chunk is retained for the caller */
+  std::pair<qubit_chunk*, uint32_t*> allocate( uint32_t size )
+  {
+    if ( _current == nullptr || _current->size + size > _current->capacity )
+    {
+      if ( _current )
+      {
+        release( _current );
+      }
+      _current = new qubit_chunk( std::max( chunk_capacity, size ) );
+    }
+
+    auto* data = _current->data.get() + _current->size;
+    _current->size += size;
+    retain( _current );
+    return {_current, data};
+  }
+
+  static qubit_arena& thread_arena()
+  {
+    thread_local qubit_arena arena;
+    return arena;
+  }
+
+private:
+  qubit_chunk* _current{nullptr};
+};
+
+} // namespace detail
+
+/*! \brief Pool of control functions shared by all compact gates
+ *
+ * Each distinct function is stored once and gates refer to it by index.
+ * Entries are reference counted by the gates that refer to them; an entry
+ * is freed when its last gate is destroyed and its index is reused.
+ */
+class stg_function_pool
+{
+public:
+  static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+  /*! \brief Inserts a function and retains a reference to it. */
+  uint32_t insert( kitty::dynamic_truth_table const& function )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    const auto it = _indexes.find( function );
+    if ( it != _indexes.end() )
+    {
+      ++_entries[it->second].references;
+      return it->second;
+    }
+
+    uint32_t index;
+    if ( _free.empty() )
+    {
+      index = static_cast<uint32_t>( _entries.size() );
+      _entries.push_back( {function, 1u} );
+    }
+    else
+    {
+      index = _free.back();
+      _free.pop_back();
+      _entries[index] = {function, 1u};
+    }
+    _indexes.emplace( function, index );
+    return index;
+  }
+
+  void retain( uint32_t index )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    assert( _entries[index].references > 0u );
+    ++_entries[index].references;
+  }
+
+  void release( uint32_t index )
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    assert( _entries[index].references > 0u );
+    if ( --_entries[index].references == 0u )
+    {
+      _indexes.erase( _entries[index].function );
+      _entries[index].function = kitty::dynamic_truth_table();
+      _free.push_back( index );
+    }
+  }
+
+  kitty::dynamic_truth_table const& operator[]( uint32_t index ) const
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    return _entries[index].function;
+  }
+
+  /*! \brief Returns the number of functions that are currently referenced. */
+  uint32_t size() const
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    return static_cast<uint32_t>( _indexes.size() );
+  }
+
+  static stg_function_pool& global()
+  {
+    static stg_function_pool pool;
+    return pool;
+  }
+
+private:
+  struct entry
+  {
+    kitty::dynamic_truth_table function;
+    uint32_t references;
+  };
+
+  mutable std::mutex _mutex;
+  std::deque<entry> _entries;
+  std::vector<uint32_t> _free;
+  std::unordered_map<kitty::dynamic_truth_table, uint32_t, kitty::hash<kitty::dynamic_truth_table>> _indexes;
+};
+
+/*! \brief Memory-efficient drop-in replacement for `stg_gate`
+ *
+ * Up to `max_inline_qubits` controls and targets are stored inside the gate,
+ * so that gates with at most 3 controls do not allocate any memory.  Larger
+ * qubit lists are appended to a chunked arena, and control functions are
+ * stored once in a `stg_function_pool`.
+ */
+class compact_stg_gate : public td::gate_base
+{
+public:
+  static constexpr uint32_t max_inline_qubits = 4u;
+
+  compact_stg_gate( gate_base const& op, td::qubit_id target )
+      : td::gate_base( op ),
+        _num_targets( 1u )
+  {
+    assert( is_single_qubit() );
+    _qubits.literals[0] = target.literal();
+  }
+
+  compact_stg_gate( gate_base const& op, td::qubit_id control, td::qubit_id target )
+      : td::gate_base( op ),
+        _num_controls( 1u ),
+        _num_targets( 1u )
+  {
+    assert( is_double_qubit() );
+    _qubits.literals[0] = control.literal();
+    _qubits.literals[1] = target.literal();
+  }
+
+  compact_stg_gate( gate_base const& op, std::vector<td::qubit_id> const& controls, std::vector<td::qubit_id> const& targets )
+      : td::gate_base( op )
+  {
+    assign( controls, targets.begin(), targets.end() );
+  }
+
+  compact_stg_gate( kitty::dynamic_truth_table const& function, std::vector<td::qubit_id> const& controls, td::qubit_id target )
+      : gate_base( td::gate_set::num_defined_ops ),
+        _function( stg_function_pool::global().insert( function ) )
+  {
+    assign( controls, &target, &target + 1 );
+  }
+
+  compact_stg_gate( compact_stg_gate const& other )
+      : td::gate_base( other ),
+        _function( other._function ),
+        _num_controls( other._num_controls ),
+        _num_targets( other._num_targets ),
+        _qubits( other._qubits )
+  {
+    if ( is_spilled() )
+    {
+      detail::retain( _qubits.spilled.chunk );
+    }
+    if ( has_function() )
+    {
+      stg_function_pool::global().retain( _function );
+    }
+  }
+
+  compact_stg_gate( compact_stg_gate&& other ) noexcept
+      : td::gate_base( other ),
+        _function( other._function ),
+        _num_controls( other._num_controls ),
+        _num_targets( other._num_targets ),
+        _qubits( other._qubits )
+  {
+    other._num_controls = other._num_targets = 0u;
+    other._function = stg_function_pool::none;
+  }
+
+  compact_stg_gate& operator=( compact_stg_gate other ) noexcept
+  {
+    swap( other );
+    return *this;
+  }
+
+  ~compact_stg_gate()
+  {
+    if ( is_spilled() )
+    {
+      detail::release( _qubits.spilled.chunk );
+    }
+    if ( has_function() )
+    {
+      stg_function_pool::global().release( _function );
+    }
+  }
+
+  bool is_unitary_gate() const
+  {
+    return td::gate_base::is_unitary_gate() || operation() == td::gate_set::num_defined_ops;
+  }
+
+  uint32_t num_controls() const
+  {
+    return _num_controls;
+  }
+
+  uint32_t num_targets() const
+  {
+    return _num_targets;
+  }
+
+  /*! \brief Returns true if the gate has a control function. */
+  bool has_function() const
+  {
+    return _function != stg_function_pool::none;
+  }
+
+  /*! \brief Returns the control function of a single-target gate. */
+  kitty::dynamic_truth_table const& function() const
+  {
+    assert( has_function() );
+    return stg_function_pool::global()[_function];
+  }
+
+  template<typename Fn>
+  void foreach_control( Fn&& fn ) const
+  {
+    const auto* literals = qubits();
+    for ( auto i = 0u; i < _num_controls; ++i )
+    {
+      fn( td::qubit_id( literals[i] >> 1, ( literals[i] & 1 ) == 1 ) );
+    }
+  }
+
+  template<typename Fn>
+  void foreach_target( Fn&& fn ) const
+  {
+    const auto* literals = qubits() + _num_controls;
+    for ( auto i = 0u; i < _num_targets; ++i )
+    {
+      fn( td::qubit_id( literals[i] >> 1, ( literals[i] & 1 ) == 1 ) );
+    }
+  }
+
+private:
+  template<typename TargetIt>
+  void assign( std::vector<td::qubit_id> const& controls, TargetIt targets_begin, TargetIt targets_end )
+  {
+    const auto num_targets = std::distance( targets_begin, targets_end );
+    assert( controls.size() <= std::numeric_limits<uint16_t>::max() );
+    assert( num_targets >= 0 && num_targets <= std::numeric_limits<uint16_t>::max() );
+    _num_controls = static_cast<uint16_t>( controls.size() );
+    _num_targets = static_cast<uint16_t>( num_targets );
+
+    uint32_t* literals = _qubits.literals;
+    if ( is_spilled() )
+    {
+      const auto [chunk, data] = detail::qubit_arena::thread_arena().allocate( _num_controls + _num_targets );
+      _qubits.spilled.chunk = chunk;
+      _qubits.spilled.literals = data;
+      literals = data;
+    }
+    for ( auto const& control : controls )
+    {
+      *literals++ = control.literal();
+    }
+    for ( auto it = targets_begin; it != targets_end; ++it )
+    {
+      *literals++ = it->literal();
+    }
+  }
+
+  void swap( compact_stg_gate& other ) noexcept
+  {
+    std::swap( static_cast<td::gate_base&>( *this ), static_cast<td::gate_base&>( other ) );
+    std::swap( _function, other._function );
+    std::swap( _num_controls, other._num_controls );
+    std::swap( _num_targets, other._num_targets );
+    std::swap( _qubits, other._qubits );
+  }
+
+  bool is_spilled() const
+  {
+    return static_cast<uint32_t>( _num_controls ) + _num_targets > max_inline_qubits;
+  }
+
+  uint32_t const* qubits() const
+  {
+    return is_spilled() ? _qubits.spilled.literals : _qubits.literals;
+  }
+
+private:
+  struct spilled_qubits
+  {
+    detail::qubit_chunk* chunk;
+    uint32_t const* literals;
+  };
+
+  /*! \brief index of the control function in the function pool */
+  uint32_t _function{stg_function_pool::none};
+
+  uint16_t _num_controls{0u};
+  uint16_t _num_targets{0u};
+
+  union qubit_storage
+  {
+    uint32_t literals[max_inline_qubits];
+    spilled_qubits spilled;
+  };
+
+  /*! \brief qubit literals, controls are followed by targets */
+  qubit_storage _qubits{};
+};
+
+} // namespace caterpillar
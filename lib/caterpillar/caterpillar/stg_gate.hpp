@@ -67,6 +67,18 @@ public:
     return _targets.size();
   }
 
+  /*! \brief Returns true if the gate has a control function. */
+  bool has_function() const
+  {
+    return operation() == td::gate_set::num_defined_ops;
+  }
+
+  /*! \brief Returns the control function of a single-target gate. */
+  kitty::dynamic_truth_table const& function() const
+  {
+    return _function;
+  }
+
   template<typename Fn>
   void foreach_control( Fn&& fn ) const
   {
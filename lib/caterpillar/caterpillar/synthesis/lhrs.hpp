@@ -16,9 +16,15 @@
 #include <mockturtle/utils/node_map.hpp>
 #include <mockturtle/utils/stopwatch.hpp>
 #include <mockturtle/views/topo_view.hpp>
+#include <kitty/hash.hpp>
 #include <tweedledum/algorithms/synthesis/stg.hpp>
+#include <tweedledum/networks/gate_recorder.hpp>
+#include <tweedledum/utils/parallel_for.hpp>
 #include <stack>
 
+#include <numeric>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -34,6 +40,17 @@ struct logic_network_synthesis_params
 {
   /*! \brief Be verbose. */
   bool verbose{false};
+
+  /*! \brief Number of threads for LUT synthesis.
+   *
+   * If different from 1, the single-target gates for all LUT functions are
+   * synthesized up front in parallel (0 uses all hardware threads) and then
+   * spliced into the quantum network in step order.  Each distinct LUT
+   * function is synthesized only once.  This requires that the single-target
+   * gate synthesis function accepts a `tweedledum::gate_recorder` as network
+   * and can be called concurrently.
+   */
+  uint32_t num_threads{1u};
 };
 
 struct logic_network_synthesis_stats
@@ -84,6 +101,13 @@ public:
     {
       return false;
     }
+    if constexpr ( std::is_invocable_v<SingleTargetGateSynthesisFn const&, tweedledum::gate_recorder&, SetQubits const&, kitty::dynamic_truth_table const&> )
+    {
+      if ( ps.num_threads != 1u )
+      {
+        precompute_luts();
+      }
+    }
     strategy.foreach_step( [&]( auto node, auto action ) {
       std::visit(
           overloaded{
@@ -232,6 +256,92 @@ private:
     return controls;
   }
 
+  /* whether compute_node synthesizes the node as a LUT */
+  bool is_lut_node( mt::node<LogicNetwork> const& node ) const
+  {
+    if constexpr ( mt::has_is_and_v<LogicNetwork> )
+    {
+      if ( ntk.is_and( node ) )
+        return false;
+    }
+    if constexpr ( mt::has_is_or_v<LogicNetwork> )
+    {
+      if ( ntk.is_or( node ) )
+        return false;
+    }
+    if constexpr ( mt::has_is_xor_v<LogicNetwork> )
+    {
+      if ( ntk.is_xor( node ) )
+        return false;
+    }
+    if constexpr ( mt::has_is_xor3_v<LogicNetwork> )
+    {
+      if ( ntk.is_xor3( node ) )
+        return false;
+    }
+    if constexpr ( mt::has_is_maj_v<LogicNetwork> )
+    {
+      if ( ntk.is_maj( node ) )
+        return false;
+    }
+    if constexpr ( mt::has_node_function_v<LogicNetwork> )
+    {
+      kitty::dynamic_truth_table tt = ntk.node_function( node );
+      auto clone = tt.construct();
+      kitty::create_parity( clone );
+      return tt != clone;
+    }
+    else
+    {
+      (void)node;
+      return false;
+    }
+  }
+
+  /* synthesizes all LUT functions that are used by the steps in parallel */
+  void precompute_luts()
+  {
+    std::vector<kitty::dynamic_truth_table const*> functions;
+
+    const auto add_function = [&]( kitty::dynamic_truth_table const& function ) {
+      if ( const auto [it, inserted] = lut_index.emplace( function, static_cast<uint32_t>( functions.size() ) ); inserted )
+      {
+        functions.push_back( &it->first );
+      }
+    };
+    const auto add_node = [&]( mt::node<LogicNetwork> const& node, auto const& cell_override ) {
+      if ( cell_override )
+      {
+        add_function( cell_override->first );
+      }
+      else if constexpr ( mt::has_node_function_v<LogicNetwork> )
+      {
+        if ( is_lut_node( node ) )
+        {
+          add_function( ntk.node_function( node ) );
+        }
+      }
+    };
+
+    strategy.foreach_step( [&]( auto node, auto const& action ) {
+      std::visit(
+          overloaded{
+              []( auto const& ) {},
+              [&]( compute_action const& action ) { add_node( node, action.cell_override ); },
+              [&]( uncompute_action const& action ) { add_node( node, action.cell_override ); }},
+          action );
+    } );
+
+    luts.resize( functions.size() );
+    tweedledum::parallel_for( static_cast<uint32_t>( functions.size() ), [&]( uint32_t i ) {
+      auto const& function = *functions[i];
+      std::vector<tweedledum::qubit_id> qubits( function.num_vars() + 1u );
+      std::iota( qubits.begin(), qubits.end(), 0u );
+      luts[i] = tweedledum::gate_recorder( function.num_vars() + 1u );
+      stg_fn( luts[i], qubits, function );
+    }, ps.num_threads );
+  }
+
   void compute_node( mt::node<LogicNetwork> const& node, uint32_t t )
   {
     if constexpr ( mt::has_is_and_v<LogicNetwork> )
@@ -489,7 +599,23 @@ private:
   {
     auto qubit_map = controls;
     qubit_map.push_back( t );
-    stg_fn( qnet, qubit_map, function );
+    if ( const auto it = lut_index.find( function ); it != lut_index.end() )
+    {
+      luts[it->second].replay( qnet, qubit_map );
+    }
+    else if constexpr ( std::is_invocable_v<SingleTargetGateSynthesisFn const&, QuantumNetwork&, SetQubits const&, kitty::dynamic_truth_table const&> )
+    {
+      stg_fn( qnet, qubit_map, function );
+    }
+    else
+    {
+      /* synthesis function can only record gates */
+      SetQubits qubits( qubit_map.size() );
+      std::iota( qubits.begin(), qubits.end(), 0u );
+      tweedledum::gate_recorder lut( qubit_map.size() );
+      stg_fn( lut, qubits, function );
+      lut.replay( qnet, qubit_map );
+    }
   }
 
   void compute_xor_inplace( uint32_t c1, uint32_t c2, bool inv, uint32_t t )
@@ -547,6 +673,8 @@ private:
   logic_network_synthesis_stats& st;
   mt::node_map<uint32_t, LogicNetwork> node_to_qubit;
   std::stack<uint32_t> free_ancillae;
+  std::unordered_map<kitty::dynamic_truth_table, uint32_t, kitty::hash<kitty::dynamic_truth_table>> lut_index;
+  std::vector<tweedledum::gate_recorder> luts;
 }; // namespace detail
 
 } // namespace detail
@@ -5,8 +5,10 @@
 *-----------------------------------------------------------------------------*/
 #pragma once
 
+#include <cassert>
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
@@ -21,17 +23,30 @@
 namespace caterpillar
 {
 
-template<typename Network>
+/*! \brief SAT-based pebbling solver
+ *
+ * The solver encodes the pebble configurations of a growing number of steps.
+ * The number of pebbles in each step is bounded by a sequential counter whose
+ * outputs are enabled through assumptions, such that the pebble limit can be
+ * changed with `set_pebbles` (up to `max_pebbles`) and the number of steps can
+ * be reset with `reset_steps` without re-encoding any step, and learned
+ * clauses are kept across calls to `solve`.  Any of the solver wrappers in
+ * percy can be used as `Solver`.
+ */
+template<typename Network, typename Solver = percy::bsat_wrapper>
 class pebble_solver
 {
   using Steps = std::vector<std::pair<mockturtle::node<Network>, mapping_strategy_action>>;
 
 public:
-  pebble_solver( Network const& net, uint32_t pebbles )
+  /* `max_pebbles` is the largest limit that can be set with `set_pebbles`
+     (0 means `pebbles`) */
+  pebble_solver( Network const& net, uint32_t pebbles, uint32_t max_pebbles = 0u )
       : index_to_gate( net.num_gates() ),
         gate_to_index( net ),
         _net( net ),
         _pebbles( pebbles ),
+        _max_pebbles( max_pebbles == 0u ? pebbles : max_pebbles ),
         _nr_gates( net.num_gates() )
   {
     net.foreach_gate( [&]( auto a, auto i ) {
@@ -43,7 +58,11 @@ public:
       o_set.insert( net.get_node( po ) );
     } );
 
-    extra = ( _pebbles < _nr_gates ) ? _pebbles * ( _nr_gates - _pebbles ) : 0;
+    /* counter variable (i, j) is true, if at least j + 1 of the first i + 1
+       gates are pebbled; counting up to _max_pebbles + 1 is sufficient */
+    _counter_width = ( _max_pebbles > 0 && _max_pebbles < _nr_gates ) ? _max_pebbles + 1 : 0;
+    extra = _nr_gates * _counter_width;
+    assert( supports_pebbles( pebbles ) );
   }
 
   inline uint32_t current_step() const
@@ -51,6 +70,45 @@ public:
     return _nr_steps;
   }
 
+  inline uint32_t pebbles() const
+  {
+    return _pebbles;
+  }
+
+  /*! \brief Returns true, if the pebble limit can be set without re-encoding. */
+  inline bool supports_pebbles( uint32_t pebbles ) const
+  {
+    return pebbles == 0 || pebbles >= _nr_gates || ( _counter_width > 0 && pebbles <= _max_pebbles );
+  }
+
+  /*! \brief Changes the pebble limit (0 means no limit) for subsequent calls to `solve`. */
+  void set_pebbles( uint32_t pebbles )
+  {
+    assert( supports_pebbles( pebbles ) );
+    _pebbles = pebbles;
+  }
+
+  /*! \brief Lowers the pebble limit permanently, i.e., it cannot be increased afterwards.
+   *
+   * Unlike `set_pebbles`, the bound is added as a clause instead of an
+   * assumption, which lets the solver simplify the encoding.
+   */
+  void restrict_pebbles( uint32_t pebbles )
+  {
+    set_pebbles( pebbles );
+    if ( pebbles > 0 && pebbles < _nr_gates )
+    {
+      int lit = pabc::Abc_Var2Lit( bound_var( pebbles ), 0 );
+      solver.add_clause( &lit, &lit + 1 );
+    }
+  }
+
+  /*! \brief Solves again starting from the first step, encoded steps are reused by `add_step`. */
+  void reset_steps()
+  {
+    _nr_steps = 0;
+  }
+
   inline void add_edge_clause( int p, int p_n, int ch, int ch_n )
   {
     int h[3];
@@ -90,6 +148,11 @@ public:
   void add_step()
   {
     _nr_steps++;
+    if ( _nr_steps <= _nr_encoded_steps )
+    {
+      return;
+    }
+    _nr_encoded_steps = _nr_steps;
     solver.set_nr_vars( ( _nr_gates + extra ) * ( 1 + _nr_steps ) );
 
     /* encode move */
@@ -108,72 +171,71 @@ public:
       } );
     } );
 
-    /* cardinality constraint */
-    if ( ( _pebbles > 0 ) && ( _nr_gates > _pebbles ) )
+    /* sequential counter over the pebbles of this step, the bound for p
+       pebbles is enabled by assuming bound_var( p ) in `solve` */
+    for ( auto i = 0u; i < _nr_gates; ++i )
     {
-      /* var declaration */
-      std::vector<std::vector<int>> card_vars( _nr_gates - _pebbles );
-      auto id_start = _nr_steps * ( _nr_gates + extra ) + _nr_gates;
-      for ( auto j = 0u; j < _nr_gates - _pebbles; ++j )
+      const auto x = pebble_var( _nr_steps, i );
+      for ( auto j = 0u; j < _counter_width && j <= i; ++j )
       {
-        for ( auto k = 0u; k < _pebbles; ++k )
+        int h[3];
+        h[0] = pabc::Abc_Var2Lit( counter_var( _nr_steps, i, j ), 0 );
+        if ( i > 0u && j < i )
         {
-          card_vars[j].push_back( id_start );
-          id_start++;
+          /* s(i - 1, j) -> s(i, j) */
+          h[1] = pabc::Abc_Var2Lit( counter_var( _nr_steps, i - 1, j ), 1 );
+          solver.add_clause( h, h + 2 );
         }
-      }
-
-      /* constraint */
-      for ( auto j = 0u; j < _nr_gates - _pebbles - 1u; j++ )
-      {
-        for ( auto k = 0u; k < _pebbles; k++ )
+        /* x(i) & s(i - 1, j - 1) -> s(i, j) */
+        h[1] = pabc::Abc_Var2Lit( x, 1 );
+        if ( j == 0u )
         {
-          int to_or[2];
-          to_or[0] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-          to_or[1] = pabc::Abc_Var2Lit( card_vars[j + 1][k], 0 );
-          solver.add_clause( to_or, to_or + 2 );
+          solver.add_clause( h, h + 2 );
         }
-      }
-
-      for ( auto j = 0u; j < _nr_gates - _pebbles; j++ )
-      {
-
-        for ( auto kp = 0u; kp <= _pebbles; kp++ )
+        else
         {
-          int k = kp - 1;
-          int to_var_or[3];
-
-          if ( k == -1 )
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k + 1], 0 );
-            solver.add_clause( to_var_or, to_var_or + 2 );
-          }
-          else if ( k == static_cast<int>( _pebbles - 1 ) )
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-            solver.add_clause( to_var_or, to_var_or + 2 );
-          }
-          else
-          {
-            to_var_or[0] = pabc::Abc_Var2Lit( _nr_steps * ( _nr_gates + extra ) + j + k + 1, 1 );
-            to_var_or[1] = pabc::Abc_Var2Lit( card_vars[j][k], 1 );
-            to_var_or[2] = pabc::Abc_Var2Lit( card_vars[j][k + 1], 0 );
-            solver.add_clause( to_var_or, to_var_or + 3 );
-          }
+          h[2] = pabc::Abc_Var2Lit( counter_var( _nr_steps, i - 1, j - 1 ), 1 );
+          solver.add_clause( h, h + 3 );
         }
       }
     }
+    for ( auto j = 1u; j < _counter_width; ++j )
+    {
+      /* bound(j) -> !s(n - 1, j) */
+      int h[2];
+      h[0] = pabc::Abc_Var2Lit( bound_var( j ), 1 );
+      h[1] = pabc::Abc_Var2Lit( counter_var( _nr_steps, _nr_gates - 1, j ), 1 );
+      solver.add_clause( h, h + 2 );
+    }
   }
 
   percy::synth_result solve( uint32_t conflict_limit )
   {
-    std::vector<int> p( _nr_gates );
-    _net.foreach_gate( [&]( auto n, auto i ) {
-      p[i] = pabc::Abc_Var2Lit( pebble_var( _nr_steps, i ), o_set.count( n ) ? 0 : 1 );
-    } );
-    return solver.solve( &p[0], &p[0] + _nr_gates, conflict_limit );
+    auto p = assumptions();
+    return solver.solve( &p[0], &p[0] + p.size(), conflict_limit );
+  }
+
+  /*! \brief Solves in slices of `slice_size` conflicts and returns timeout as
+   *         soon as `stop()` returns true after a slice. */
+  template<typename StopFn>
+  percy::synth_result solve( uint32_t conflict_limit, uint32_t slice_size, StopFn&& stop )
+  {
+    auto p = assumptions();
+    auto remaining = conflict_limit;
+    while ( !stop() )
+    {
+      const auto limit = conflict_limit ? std::min( slice_size, remaining ) : slice_size;
+      const auto result = solver.solve( &p[0], &p[0] + p.size(), limit );
+      if ( result != percy::timeout )
+      {
+        return result;
+      }
+      if ( conflict_limit && ( remaining -= limit ) == 0u )
+      {
+        break;
+      }
+    }
+    return percy::timeout;
   }
 
   inline int pebble_var( int step, int gate )
@@ -181,6 +243,32 @@ public:
     return step * ( extra + _nr_gates ) + gate;
   }
 
+  inline int counter_var( int step, int gate, int count )
+  {
+    return step * ( extra + _nr_gates ) + _nr_gates + gate * _counter_width + count;
+  }
+
+  /* the counter variables of step 0 are not used by the encoding, the first
+     of them enable the bounds for the different pebble limits */
+  inline int bound_var( int pebbles )
+  {
+    return counter_var( 0, 0, pebbles );
+  }
+
+  /* final configuration, and bound on the number of pebbles */
+  std::vector<int> assumptions()
+  {
+    std::vector<int> p( _nr_gates );
+    _net.foreach_gate( [&]( auto n, auto i ) {
+      p[i] = pabc::Abc_Var2Lit( pebble_var( _nr_steps, i ), o_set.count( n ) ? 0 : 1 );
+    } );
+    if ( ( _pebbles > 0 ) && ( _nr_gates > _pebbles ) )
+    {
+      p.push_back( pabc::Abc_Var2Lit( bound_var( _pebbles ), 0 ) );
+    }
+    return p;
+  }
+
   Steps extract_result()
   {
     std::vector<std::vector<int>> vals_step( _nr_steps + 1 );
@@ -338,11 +426,14 @@ private:
   mockturtle::node_map<int, Network> gate_to_index;
   std::unordered_set<mockturtle::node<Network>> o_set;
 
-  percy::bsat_wrapper solver;
+  Solver solver;
   Network const& _net;
   uint32_t _pebbles;
+  uint32_t _max_pebbles;
   uint32_t _nr_gates;
   uint32_t _nr_steps = 0;
+  uint32_t _nr_encoded_steps = 0;
+  uint32_t _counter_width;
   uint32_t extra;
 };
 
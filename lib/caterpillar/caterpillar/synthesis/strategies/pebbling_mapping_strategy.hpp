@@ -7,13 +7,21 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "mapping_strategy.hpp"
 #include "../sat.hpp"
 
 #include <mockturtle/utils/progress_bar.hpp>
+#include <percy/solvers/bmcg_sat.hpp>
+#include <tweedledum/utils/parallel_for.hpp>
 
 namespace caterpillar
 {
@@ -36,6 +44,17 @@ struct pebbling_mapping_strategy_params
 
   /*! \brief Decrement pebble numbers, if satisfiable. */
   bool decrement_on_success{false};
+
+  /*! \brief Number of threads (0 means hardware concurrency).
+   *
+   * With more than one thread, a portfolio of SAT solvers searches for the
+   * smallest number of pebbles up to `pebble_limit` (or the number of gates),
+   * and `increment_on_timeout` and `decrement_on_success` are ignored.
+   */
+  uint32_t num_threads{1u};
+
+  /*! \brief Wall-clock time limit in seconds for the portfolio search (0 means no limit). */
+  double time_limit{0.0};
 };
 
 template<class LogicNetwork>
@@ -58,29 +77,62 @@ public:
 
   bool compute_steps( LogicNetwork const& ntk ) override
   {
+    if ( tweedledum::resolve_num_threads( ps.num_threads ) > 1u )
+    {
+      return compute_steps_portfolio( ntk );
+    }
+
     assert( !ps.decrement_on_success || !ps.increment_on_timeout );
-    std::vector<std::pair<mockturtle::node<LogicNetwork>, mapping_strategy_action>> store_steps;
+    const auto num_gates = ntk.num_gates();
     auto limit = ps.pebble_limit;
+    if ( ps.decrement_on_success && limit == 0u )
+    {
+      limit = num_gates;
+    }
     unsigned max_steps = 100;
+
+    /* one solver is used for all pebble limits; with decrement_on_success
+       the limit only decreases and is added as a clause, with
+       increment_on_timeout the solver is rebuilt for twice the limit whenever
+       the limit exceeds what is encoded */
+    std::unique_ptr<pebble_solver<LogicNetwork>> solver;
+    bool solve_current_step{false};
     while ( true )
     {
-      pebble_solver<LogicNetwork> solver( ntk, limit );
-      solver.initialize();
+      if ( !solver || !solver->supports_pebbles( limit ) )
+      {
+        const auto max_pebbles = std::min( ps.increment_on_timeout ? 2 * limit : limit, num_gates - 1 );
+        solver = std::make_unique<pebble_solver<LogicNetwork>>( ntk, limit, max_pebbles );
+        solver->initialize();
+        solve_current_step = false;
+      }
+      else if ( ps.decrement_on_success )
+      {
+        solver->restrict_pebbles( limit );
+      }
+      else
+      {
+        solver->set_pebbles( limit );
+      }
 
       mockturtle::progress_bar bar( 100, "|{0}| current step = {1}", ps.progress );
       percy::synth_result result;
 
       do
       {
-        if ( solver.current_step() >= max_steps )
+        if ( !solve_current_step )
         {
-          result = percy::timeout;
-          break;
-        }
+          if ( solver->current_step() >= max_steps )
+          {
+            result = percy::timeout;
+            break;
+          }
 
-        bar( std::min<uint32_t>( solver.current_step(), 100 ), solver.current_step() );
-        solver.add_step();
-        result = solver.solve( ps.conflict_limit );
+          bar( std::min<uint32_t>( solver->current_step(), 100 ), solver->current_step() );
+          solver->add_step();
+        }
+        solve_current_step = false;
+        result = solver->solve( ps.conflict_limit );
       } while ( result == percy::failure );
 
       if ( result == percy::timeout )
@@ -88,6 +140,8 @@ public:
         if ( ps.increment_on_timeout )
         {
           limit++;
+          /* fewer steps may suffice with more pebbles */
+          solver->reset_steps();
           continue;
         }
         else if ( !ps.decrement_on_success )
@@ -95,10 +149,13 @@ public:
       }
       else if ( result == percy::success )
       {
-        this->steps() = solver.extract_result();
-        if ( ps.decrement_on_success )
+        this->steps() = solver->extract_result();
+        /* a solution with fewer pebbles requires at least as many steps,
+           therefore the search continues from the current step */
+        if ( ps.decrement_on_success && limit > 1u )
         {
           limit--;
+          solve_current_step = true;
           continue;
         }
       }
@@ -110,6 +167,120 @@ public:
     }
   }
 
+private:
+  /* Runs at most num_threads workers, each with its own SAT solver, which
+     alternate between the solver types.  Every pebble limit (from the largest
+     to the smallest) is handed out once per solver type, and only when a
+     worker asks for its next limit.  Since the limits of a worker decrease,
+     it keeps one SAT instance, which is restricted to each new limit, and
+     continues from its current step (a limit that cannot be met in k steps
+     cannot be met with fewer pebbles either).  Limits are skipped and running
+     jobs are cancelled, as soon as a solution with at most as many pebbles is
+     found, or when a larger limit has been shown to require more than
+     max_steps steps. */
+  bool compute_steps_portfolio( LogicNetwork const& ntk )
+  {
+    const auto num_gates = ntk.num_gates();
+    const auto max_limit = ps.pebble_limit == 0u ? num_gates : std::min( ps.pebble_limit, num_gates );
+    const uint32_t max_steps = 100u;
+    const uint32_t slice_size = 1000u;
+    const uint32_t num_solvers = 2u;
+    const auto num_workers = std::min( tweedledum::resolve_num_threads( ps.num_threads ), max_limit * num_solvers );
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( ps.time_limit ) );
+
+    /* smallest limit with a solution, and largest limit without solution */
+    std::atomic<uint32_t> best_limit{std::numeric_limits<uint32_t>::max()};
+    std::atomic<uint32_t> failed_limit{0u};
+    std::mutex mutex;
+
+    /* next limit to hand out for each solver type */
+    std::vector<uint32_t> next_limit( num_solvers, max_limit );
+
+    const auto timed_out = [&]() {
+      return ps.time_limit > 0.0 && std::chrono::steady_clock::now() >= deadline;
+    };
+
+    const auto stopped = [&]( uint32_t limit ) {
+      return limit >= best_limit || limit <= failed_limit || timed_out();
+    };
+
+    /* returns 0, if there are no more limits to try */
+    const auto take_limit = [&]( uint32_t solver_type ) {
+      std::lock_guard<std::mutex> lock( mutex );
+      auto& next = next_limit[solver_type];
+      if ( best_limit != std::numeric_limits<uint32_t>::max() )
+      {
+        next = std::min<uint32_t>( next, best_limit - 1u );
+      }
+      if ( next <= failed_limit || timed_out() )
+      {
+        return 0u;
+      }
+      return next--;
+    };
+
+    const auto run_worker = [&]( auto& solver, uint32_t solver_type, uint32_t limit ) {
+      solver.initialize();
+      for ( ; limit != 0u; limit = take_limit( solver_type ) )
+      {
+        solver.restrict_pebbles( limit );
+
+        /* the current step has not been solved for this limit yet */
+        auto result = solver.current_step() == 0u ? percy::failure : solver.solve( ps.conflict_limit, slice_size, [&]() { return stopped( limit ); } );
+        while ( result == percy::failure && solver.current_step() < max_steps )
+        {
+          solver.add_step();
+          result = solver.solve( ps.conflict_limit, slice_size, [&]() { return stopped( limit ); } );
+        }
+
+        if ( result == percy::success )
+        {
+          std::lock_guard<std::mutex> lock( mutex );
+          if ( limit < best_limit )
+          {
+            best_limit = limit;
+            this->steps() = solver.extract_result();
+          }
+        }
+        else if ( result == percy::failure )
+        {
+          /* fewer pebbles cannot be done in fewer steps */
+          std::lock_guard<std::mutex> lock( mutex );
+          failed_limit = std::max<uint32_t>( failed_limit, limit );
+        }
+      }
+    };
+
+    tweedledum::parallel_for( num_workers, [&]( uint32_t worker ) {
+      const auto solver_type = worker % num_solvers;
+      const auto limit = take_limit( solver_type );
+      if ( limit == 0u )
+      {
+        return;
+      }
+
+      /* the SAT instance is encoded for the first limit, and supports all smaller ones */
+      const auto max_pebbles = std::min( limit, num_gates - 1u );
+      switch ( solver_type )
+      {
+      default:
+      case 0u: {
+        pebble_solver<LogicNetwork, percy::bsat_wrapper> solver( ntk, limit, max_pebbles );
+        run_worker( solver, solver_type, limit );
+        break;
+      }
+      case 1u: {
+        /* Glucose, as integrated in ABC */
+        pebble_solver<LogicNetwork, percy::bmcg_wrapper> solver( ntk, limit, max_pebbles );
+        run_worker( solver, solver_type, limit );
+        break;
+      }
+      }
+    }, num_workers );
+
+    return best_limit != std::numeric_limits<uint32_t>::max() && !this->steps().empty();
+  }
+
 private:
   pebbling_mapping_strategy_params ps;
 };
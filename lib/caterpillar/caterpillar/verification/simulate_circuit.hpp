@@ -0,0 +1,400 @@
+/*------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-----------------------------------------------------------------------------*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <kitty/detail/constants.hpp>
+#include <kitty/dynamic_truth_table.hpp>
+#include <tweedledum/gates/gate_set.hpp>
+#include <tweedledum/utils/parallel_for.hpp>
+
+namespace caterpillar
+{
+
+/*! \brief Bit-parallel simulator for reversible circuits
+ *
+ * The X, CX, MCX, and SWAP gates of a circuit are compiled once into a flat
+ * list of operations.  The simulator then evaluates blocks of input patterns,
+ * in which the state of each qubit is stored in `block_size` words of 64
+ * patterns each, such that every gate is applied to all patterns of a block
+ * with a few word operations.
+ */
+class bit_parallel_simulator
+{
+public:
+  /*! \brief Number of words per qubit that are simulated together */
+  static constexpr uint32_t block_size = 32u;
+
+  /*! \brief Compiles a circuit for simulation.
+   *
+   * Returns `std::nullopt`, if the circuit contains a non-classical gate.
+   */
+  template<class QuantumCircuit>
+  static std::optional<bit_parallel_simulator> from_circuit( QuantumCircuit const& circ )
+  {
+    using tweedledum::gate_set;
+
+    bit_parallel_simulator sim;
+    sim._num_qubits = circ.num_qubits();
+
+    bool error{false};
+    circ.foreach_cgate( [&]( auto const& n ) {
+      auto const& g = n.gate;
+      if ( !( g.is( gate_set::pauli_x ) || g.is( gate_set::cx ) || g.is( gate_set::mcx ) || g.is( gate_set::swap ) ) )
+      {
+        error = true;
+        return false;
+      }
+
+      operation op;
+      op.first = static_cast<uint32_t>( sim._literals.size() );
+      op.num_controls = static_cast<uint32_t>( g.num_controls() );
+      op.num_targets = static_cast<uint32_t>( g.num_targets() );
+      op.is_swap = g.is( gate_set::swap );
+      g.foreach_control( [&]( auto c ) { sim._literals.push_back( c.literal() ); } );
+      g.foreach_target( [&]( auto t ) { sim._literals.push_back( t.index() ); } );
+      sim._operations.push_back( op );
+      return true;
+    } );
+
+    if ( error )
+    {
+      return std::nullopt;
+    }
+    return sim;
+  }
+
+  uint32_t num_qubits() const
+  {
+    return _num_qubits;
+  }
+
+  /*! \brief Simulates one block of patterns in place.
+   *
+   * Word `w` of qubit `q` is `state[q * block_size + w]`.
+   */
+  void simulate( uint64_t* state ) const
+  {
+    uint64_t active[block_size];
+
+    for ( auto const& op : _operations )
+    {
+      const auto* literals = _literals.data() + op.first;
+      const auto* targets = literals + op.num_controls;
+
+      if ( op.is_swap )
+      {
+        auto* a = state + targets[0] * block_size;
+        auto* b = state + targets[1] * block_size;
+        std::swap_ranges( a, a + block_size, b );
+        continue;
+      }
+
+      std::fill( active, active + block_size, ~uint64_t( 0 ) );
+      for ( auto i = 0u; i < op.num_controls; ++i )
+      {
+        const auto* word = state + ( literals[i] >> 1 ) * block_size;
+        const uint64_t polarity = ( literals[i] & 1 ) ? ~uint64_t( 0 ) : uint64_t( 0 );
+        for ( auto w = 0u; w < block_size; ++w )
+        {
+          active[w] &= word[w] ^ polarity;
+        }
+      }
+      for ( auto i = 0u; i < op.num_targets; ++i )
+      {
+        auto* word = state + targets[i] * block_size;
+        for ( auto w = 0u; w < block_size; ++w )
+        {
+          word[w] ^= active[w];
+        }
+      }
+    }
+  }
+
+private:
+  struct operation
+  {
+    /* controls (as literals) are followed by targets (as indexes) */
+    uint32_t first;
+    uint32_t num_controls;
+    uint32_t num_targets;
+    bool is_swap;
+  };
+
+  uint32_t _num_qubits{0u};
+  std::vector<operation> _operations;
+  std::vector<uint32_t> _literals;
+};
+
+namespace detail
+{
+
+/* simulates `num_words` words of patterns in blocks; `pattern( i, w )`
+   returns word `w` of the `i`-th input, all other qubits are 0; after a block
+   has been simulated, `fn( first_word, num_valid, state )` is called, and no
+   further blocks are simulated once it returns false; returns false, if the
+   simulation has been stopped */
+template<class PatternFn, class BlockFn>
+bool simulate_blocks( bit_parallel_simulator const& sim, std::vector<uint32_t> const& inputs, uint64_t num_words,
+                      PatternFn&& pattern, BlockFn&& fn, uint32_t num_threads )
+{
+  constexpr auto block_size = bit_parallel_simulator::block_size;
+  constexpr uint64_t blocks_per_task = 64u;
+
+  const auto num_blocks = ( num_words + block_size - 1u ) / block_size;
+  const auto num_tasks = static_cast<uint32_t>( ( num_blocks + blocks_per_task - 1u ) / blocks_per_task );
+  std::atomic<bool> stopped{false};
+  assert( std::all_of( inputs.begin(), inputs.end(), [&]( auto q ) { return q < sim.num_qubits(); } ) );
+
+  tweedledum::parallel_for( num_tasks, [&]( uint32_t task ) {
+    std::vector<uint64_t> state( sim.num_qubits() * block_size );
+    const auto last_block = std::min( num_blocks, ( task + 1u ) * blocks_per_task );
+    for ( auto block = task * blocks_per_task; block < last_block && !stopped; ++block )
+    {
+      const auto first_word = block * block_size;
+      const auto num_valid = static_cast<uint32_t>( std::min<uint64_t>( block_size, num_words - first_word ) );
+
+      std::fill( state.begin(), state.end(), uint64_t( 0 ) );
+      for ( auto i = 0u; i < inputs.size(); ++i )
+      {
+        for ( auto w = 0u; w < num_valid; ++w )
+        {
+          state[inputs[i] * block_size + w] = pattern( i, first_word + w );
+        }
+      }
+
+      sim.simulate( state.data() );
+
+      if ( !fn( first_word, num_valid, static_cast<uint64_t const*>( state.data() ) ) )
+      {
+        stopped = true;
+      }
+    }
+  }, num_threads );
+
+  return !stopped;
+}
+
+/* word `w` of the `i`-th variable in a truth table with at least `i + 1` variables */
+inline uint64_t projection_word( uint32_t i, uint64_t word )
+{
+  if ( i < 6u )
+  {
+    return kitty::detail::projections[i];
+  }
+  return ( ( word >> ( i - 6u ) ) & 1u ) ? ~uint64_t( 0 ) : uint64_t( 0 );
+}
+
+/* writes word `w` of every output into word `w` of the corresponding truth table */
+template<class PatternFn>
+void simulate_words( bit_parallel_simulator const& sim, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs,
+                     uint64_t num_words, PatternFn&& pattern, std::vector<kitty::dynamic_truth_table>& output_tts, uint32_t num_threads )
+{
+  constexpr auto block_size = bit_parallel_simulator::block_size;
+  assert( std::all_of( outputs.begin(), outputs.end(), [&]( auto q ) { return q < sim.num_qubits(); } ) );
+
+  simulate_blocks( sim, inputs, num_words, pattern, [&]( uint64_t first_word, uint32_t num_valid, uint64_t const* state ) {
+    for ( auto o = 0u; o < outputs.size(); ++o )
+    {
+      std::copy_n( state + outputs[o] * block_size, num_valid, output_tts[o].begin() + first_word );
+    }
+    return true;
+  }, num_threads );
+
+  for ( auto& tt : output_tts )
+  {
+    tt.mask_bits();
+  }
+}
+
+/* simulates all basis states of a circuit and calls `fn( first, values,
+   count )` for consecutive ranges of basis states starting at `first`, where
+   `values[j]` is the state of the circuit for basis state `first + j` */
+template<class Fn>
+bool simulate_basis_states( bit_parallel_simulator const& sim, Fn&& fn, uint32_t num_threads )
+{
+  constexpr auto block_size = bit_parallel_simulator::block_size;
+
+  const auto num_qubits = sim.num_qubits();
+  std::vector<uint32_t> qubits( num_qubits );
+  std::iota( qubits.begin(), qubits.end(), 0u );
+  const auto num_states = uint64_t( 1 ) << num_qubits;
+  const auto num_words = std::max<uint64_t>( num_states >> 6, 1u );
+
+  return simulate_blocks( sim, qubits, num_words, projection_word, [&]( uint64_t first_word, uint32_t num_valid, uint64_t const* state ) {
+    uint64_t values[block_size * 64u] = {};
+    for ( auto q = 0u; q < num_qubits; ++q )
+    {
+      for ( auto w = 0u; w < num_valid; ++w )
+      {
+        const auto word = state[q * block_size + w];
+        for ( auto j = 0u; j < 64u; ++j )
+        {
+          values[w * 64u + j] |= ( ( word >> j ) & 1u ) << q;
+        }
+      }
+    }
+    const auto first = first_word * 64u;
+    return fn( first, static_cast<uint64_t const*>( values ), std::min<uint64_t>( num_valid * 64u, num_states - first ) );
+  }, num_threads );
+}
+
+/* word of pseudo-random patterns that only depends on the seed, the input,
+   and the word index (but not on the number of threads) */
+inline uint64_t random_pattern_word( uint64_t seed, uint32_t input, uint64_t word )
+{
+  auto z = seed + UINT64_C( 0x9e3779b97f4a7c15 ) * ( word + 1u ) + UINT64_C( 0xd1b54a32d192ed03 ) * input;
+  z = ( z ^ ( z >> 30 ) ) * UINT64_C( 0xbf58476d1ce4e5b9 );
+  z = ( z ^ ( z >> 27 ) ) * UINT64_C( 0x94d049bb133111eb );
+  return z ^ ( z >> 31 );
+}
+
+} // namespace detail
+
+/*! \brief Simulates a reversible circuit for all input assignments.
+ *
+ * Returns the truth table of each output qubit as a function over the input
+ * qubits, where the first input qubit is the least significant variable.  All
+ * other qubits are initialized to 0.  Returns `std::nullopt`, if the circuit
+ * contains a non-classical gate.
+ *
+ * Pattern blocks are distributed over `num_threads` threads (0 means hardware
+ * concurrency).  The truth tables require 2^k bits for k inputs, therefore
+ * exhaustive simulation is practical for up to about 30 inputs.
+ *
+ * \param circ Reversible quantum circuit
+ * \param inputs Qubits which are primary inputs (distinct qubits of `circ`)
+ * \param outputs Qubits whose functions are returned (qubits of `circ`)
+ * \param num_threads Number of threads
+ */
+template<class QuantumCircuit>
+std::optional<std::vector<kitty::dynamic_truth_table>> simulate_circuit_exhaustive( QuantumCircuit const& circ, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs, uint32_t num_threads = 1u )
+{
+  const auto sim = bit_parallel_simulator::from_circuit( circ );
+  if ( !sim )
+  {
+    return std::nullopt;
+  }
+
+  const auto num_vars = static_cast<uint32_t>( inputs.size() );
+  std::vector<kitty::dynamic_truth_table> output_tts( outputs.size(), kitty::dynamic_truth_table( num_vars ) );
+  const auto num_words = output_tts.empty() ? uint64_t( 1 ) : static_cast<uint64_t>( output_tts.front().num_blocks() );
+
+  detail::simulate_words( *sim, inputs, outputs, num_words, detail::projection_word, output_tts, num_threads );
+
+  return output_tts;
+}
+
+/*! \brief Simulates a reversible circuit for random input assignments.
+ *
+ * Simulates 2^`num_vars` random input patterns.  The patterns of each input
+ * and the simulated values of each output are returned as truth tables over
+ * `num_vars` variables, where bit `j` of every truth table belongs to the
+ * `j`-th pattern.  The patterns only depend on `seed`, such that the results
+ * of two circuits with the same inputs and outputs can be compared.  All
+ * other qubits are initialized to 0.  Returns `std::nullopt`, if the circuit
+ * contains a non-classical gate.
+ *
+ * \param circ Reversible quantum circuit
+ * \param inputs Qubits which are primary inputs (distinct qubits of `circ`)
+ * \param outputs Qubits whose simulated values are returned (qubits of `circ`)
+ * \param num_vars Logarithm of the number of patterns
+ * \param seed Random seed
+ * \param num_threads Number of threads
+ */
+template<class QuantumCircuit>
+std::optional<std::pair<std::vector<kitty::dynamic_truth_table>, std::vector<kitty::dynamic_truth_table>>>
+simulate_circuit_random( QuantumCircuit const& circ, std::vector<uint32_t> const& inputs, std::vector<uint32_t> const& outputs, uint32_t num_vars, uint64_t seed = 0u, uint32_t num_threads = 1u )
+{
+  const auto sim = bit_parallel_simulator::from_circuit( circ );
+  if ( !sim )
+  {
+    return std::nullopt;
+  }
+
+  std::vector<kitty::dynamic_truth_table> input_tts( inputs.size(), kitty::dynamic_truth_table( num_vars ) );
+  std::vector<kitty::dynamic_truth_table> output_tts( outputs.size(), kitty::dynamic_truth_table( num_vars ) );
+  const auto num_words = static_cast<uint64_t>( kitty::dynamic_truth_table( num_vars ).num_blocks() );
+
+  tweedledum::parallel_for( static_cast<uint32_t>( inputs.size() ), [&]( uint32_t i ) {
+    for ( auto w = 0u; w < num_words; ++w )
+    {
+      input_tts[i]._bits[w] = detail::random_pattern_word( seed, i, w );
+    }
+    input_tts[i].mask_bits();
+  }, num_threads );
+
+  detail::simulate_words( *sim, inputs, outputs, num_words, [&]( uint32_t i, uint64_t word ) {
+    return input_tts[i]._bits[word];
+  }, output_tts, num_threads );
+
+  return std::make_pair( std::move( input_tts ), std::move( output_tts ) );
+}
+
+/*! \brief Computes the permutation of basis states that a reversible circuit implements.
+ *
+ * Entry `j` of the result is the basis state of the circuit after applying it
+ * to basis state `j`, where qubit 0 is the least significant bit.  Returns
+ * `std::nullopt`, if the circuit contains a non-classical gate.
+ *
+ * \param circ Reversible quantum circuit with at most 32 qubits
+ * \param num_threads Number of threads
+ */
+template<class QuantumCircuit>
+std::optional<std::vector<uint32_t>> circuit_to_permutation( QuantumCircuit const& circ, uint32_t num_threads = 1u )
+{
+  const auto sim = bit_parallel_simulator::from_circuit( circ );
+  if ( !sim )
+  {
+    return std::nullopt;
+  }
+
+  std::vector<uint32_t> permutation( uint64_t( 1 ) << sim->num_qubits() );
+  detail::simulate_basis_states( *sim, [&]( uint64_t first, uint64_t const* values, uint64_t count ) {
+    std::copy_n( values, count, permutation.begin() + first );
+    return true;
+  }, num_threads );
+  return permutation;
+}
+
+/*! \brief Checks whether a reversible circuit implements a permutation.
+ *
+ * The circuit must have `n` qubits for a permutation over 2^`n` basis states
+ * (see `circuit_to_permutation`), otherwise the result is false.  The check
+ * stops at the first block of basis states with a mismatch.  Returns
+ * `std::nullopt`, if the circuit contains a non-classical gate.
+ *
+ * \param circ Reversible quantum circuit
+ * \param permutation Permutation of basis states
+ * \param num_threads Number of threads
+ */
+template<class QuantumCircuit>
+std::optional<bool> circuit_implements_permutation( QuantumCircuit const& circ, std::vector<uint32_t> const& permutation, uint32_t num_threads = 1u )
+{
+  const auto sim = bit_parallel_simulator::from_circuit( circ );
+  if ( !sim )
+  {
+    return std::nullopt;
+  }
+  if ( sim->num_qubits() >= 64u || permutation.size() != ( uint64_t( 1 ) << sim->num_qubits() ) )
+  {
+    return false;
+  }
+
+  return detail::simulate_basis_states( *sim, [&]( uint64_t first, uint64_t const* values, uint64_t count ) {
+    return std::equal( values, values + count, permutation.begin() + first );
+  }, num_threads );
+}
+
+} // namespace caterpillar
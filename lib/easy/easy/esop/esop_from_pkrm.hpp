@@ -35,9 +35,14 @@
 
 #include <easy/esop/esop.hpp>
 #include <easy/esop/cube_manipulators.hpp>
+#include <kitty/bit_operations.hpp>
 #include <kitty/hash.hpp>
 #include <kitty/operations.hpp>
 #include <kitty/operators.hpp>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -55,11 +60,243 @@ enum class pkrm_decomposition
   shannon
 };
 
+/* returns the cheapest decomposition given the costs of the three sub-functions */
+inline std::pair<uint32_t, pkrm_decomposition> best_pkrm_decomposition( uint32_t ex0, uint32_t ex1, uint32_t ex2 )
+{
+  const auto ex_max = std::max( std::max( ex0, ex1 ), ex2 );
+
+  if ( ex_max == ex0 )
+  {
+    return {ex1 + ex2, pkrm_decomposition::positive_davio};
+  }
+  else if ( ex_max == ex1 )
+  {
+    return {ex0 + ex2, pkrm_decomposition::negative_davio};
+  }
+  else
+  {
+    return {ex0 + ex1, pkrm_decomposition::shannon};
+  }
+}
+
+/* moves the bits at even positions of a word into its lower half */
+inline uint64_t compress_even_bits( uint64_t word )
+{
+  word &= UINT64_C( 0x5555555555555555 );
+  word = ( word | ( word >> 1 ) ) & UINT64_C( 0x3333333333333333 );
+  word = ( word | ( word >> 2 ) ) & UINT64_C( 0x0f0f0f0f0f0f0f0f );
+  word = ( word | ( word >> 4 ) ) & UINT64_C( 0x00ff00ff00ff00ff );
+  word = ( word | ( word >> 8 ) ) & UINT64_C( 0x0000ffff0000ffff );
+  word = ( word | ( word >> 16 ) ) & UINT64_C( 0x00000000ffffffff );
+  return word;
+}
+
+inline uint64_t small_function_mask( uint32_t num_vars )
+{
+  return num_vars == 6u ? ~UINT64_C( 0 ) : ( UINT64_C( 1 ) << ( 1u << num_vars ) ) - 1u;
+}
+
+} // namespace detail
+/*! \endcond */
+
+/*! \brief Statistics of a `pkrm_expansion_cache` */
+struct pkrm_expansion_cache_stats
+{
+  /*! \brief Number of lookups that found an entry. */
+  uint64_t hits{0};
+
+  /*! \brief Number of lookups that required computing an entry. */
+  uint64_t misses{0};
+
+  /*! \brief Number of entries that were evicted to stay within the capacity. */
+  uint64_t evictions{0};
+
+  /*! \brief Number of entries currently stored. */
+  uint64_t size{0};
+};
+
+/*! \brief Expansion cache for optimum PKRM computation shared across calls
+
+  The cache is opt-in: it is only used if passed to `esop_from_optimum_pkrm`.
+
+  The cache stores the optimum decomposition for sub-functions with at most
+  6 variables.  Sub-functions are keyed by their number of variables and a
+  single truth table word, such that sub-functions that occur in different
+  functions (e.g., cofactors of different LUT functions) share entries.
+
+  The cache is bounded by `capacity` entries.  If it is full, the oldest
+  entries are evicted first.  The cache is partitioned into shards that are
+  protected by separate locks, such that it can be used from several threads
+  concurrently.
+*/
+class pkrm_expansion_cache
+{
+public:
+  static constexpr uint32_t max_num_vars = 6u;
+
+  explicit pkrm_expansion_cache( uint64_t capacity = uint64_t( 1 ) << 18 )
+      : _shard_capacity( std::max<uint64_t>( capacity / num_shards, 1u ) )
+  {
+  }
+
+  pkrm_expansion_cache( const pkrm_expansion_cache& ) = delete;
+  pkrm_expansion_cache& operator=( const pkrm_expansion_cache& ) = delete;
+
+  /*! \brief Returns cost and decomposition of the top variable for a sub-function
+
+    \param num_vars Number of variables (at most 6)
+    \param word Truth table of the sub-function
+  */
+  std::pair<uint32_t, detail::pkrm_decomposition> lookup( uint32_t num_vars, uint64_t word )
+  {
+    const auto key = make_key( num_vars, word );
+    auto& sh = _shards[shard_index( key )];
+    {
+      std::lock_guard<std::mutex> lock( sh.mutex );
+      if ( const auto it = sh.entries.find( key ); it != sh.entries.end() )
+      {
+        ++sh.stats.hits;
+        return it->second;
+      }
+    }
+
+    const auto tt0 = detail::compress_even_bits( word );
+    const auto tt1 = detail::compress_even_bits( word >> 1 );
+    const auto result = detail::best_pkrm_decomposition( cost( num_vars - 1, tt0 ), cost( num_vars - 1, tt1 ), cost( num_vars - 1, tt0 ^ tt1 ) );
+
+    std::lock_guard<std::mutex> lock( sh.mutex );
+    ++sh.stats.misses;
+    if ( sh.entries.emplace( key, result ).second )
+    {
+      sh.order.push_back( key );
+      while ( sh.order.size() > _shard_capacity )
+      {
+        sh.entries.erase( sh.order.front() );
+        sh.order.pop_front();
+        ++sh.stats.evictions;
+      }
+    }
+    return result;
+  }
+
+  /*! \brief Returns the number of cubes of the optimum PKRM for a sub-function */
+  uint32_t cost( uint32_t num_vars, uint64_t word )
+  {
+    if ( word == 0u )
+    {
+      return 0u;
+    }
+    if ( word == detail::small_function_mask( num_vars ) )
+    {
+      return 1u;
+    }
+    return lookup( num_vars, word ).first;
+  }
+
+  /*! \brief Returns accumulated statistics */
+  pkrm_expansion_cache_stats stats() const
+  {
+    pkrm_expansion_cache_stats st;
+    for ( auto& sh : _shards )
+    {
+      std::lock_guard<std::mutex> lock( sh.mutex );
+      st.hits += sh.stats.hits;
+      st.misses += sh.stats.misses;
+      st.evictions += sh.stats.evictions;
+      st.size += sh.entries.size();
+    }
+    return st;
+  }
+
+  /*! \brief Removes all entries and resets the statistics */
+  void clear()
+  {
+    for ( auto& sh : _shards )
+    {
+      std::lock_guard<std::mutex> lock( sh.mutex );
+      sh.entries.clear();
+      sh.order.clear();
+      sh.stats = {};
+    }
+  }
+
+private:
+  struct key_t
+  {
+    uint64_t word;
+    uint32_t num_vars;
+
+    bool operator==( const key_t& other ) const
+    {
+      return word == other.word && num_vars == other.num_vars;
+    }
+  };
+
+  struct key_hash
+  {
+    std::size_t operator()( const key_t& key ) const
+    {
+      return static_cast<std::size_t>( ( key.word ^ ( uint64_t( key.num_vars ) << 59u ) ) * UINT64_C( 0x9e3779b97f4a7c15 ) >> 7u );
+    }
+  };
+
+  struct shard
+  {
+    mutable std::mutex mutex;
+    std::unordered_map<key_t, std::pair<uint32_t, detail::pkrm_decomposition>, key_hash> entries;
+    std::deque<key_t> order;
+    pkrm_expansion_cache_stats stats;
+  };
+
+  static constexpr uint32_t num_shards = 16u;
+
+  static key_t make_key( uint32_t num_vars, uint64_t word )
+  {
+    return {word, num_vars};
+  }
+
+  static uint32_t shard_index( const key_t& key )
+  {
+    return static_cast<uint32_t>( ( key.word * UINT64_C( 0x9e3779b97f4a7c15 ) + key.num_vars ) >> 60u ) % num_shards;
+  }
+
+private:
+  uint64_t _shard_capacity;
+  std::array<shard, num_shards> _shards;
+};
+
+/*! \cond PRIVATE */
+namespace detail
+{
+
+/* returns the sub-function of a function that does not depend on variables
+   below var_index as a word over the remaining variables */
+template<typename TT>
+inline uint64_t compact_sub_function( const TT& tt, uint8_t var_index )
+{
+  const auto num_vars = static_cast<uint32_t>( tt.num_vars() ) - var_index;
+  uint64_t word{0};
+  for ( auto j = 0u; j < ( 1u << num_vars ); ++j )
+  {
+    if ( kitty::get_bit( tt, uint64_t( j ) << var_index ) )
+    {
+      word |= uint64_t( 1 ) << j;
+    }
+  }
+  return word;
+}
+
+template<typename TT>
+inline bool use_shared_expansion_cache( const TT& tt, uint8_t var_index, pkrm_expansion_cache* shared )
+{
+  return shared != nullptr && static_cast<uint32_t>( tt.num_vars() ) - var_index <= pkrm_expansion_cache::max_num_vars;
+}
+
 template<typename TT>
 using expansion_cache = std::unordered_map<TT, std::pair<uint32_t, pkrm_decomposition>, kitty::hash<TT>>;
 
 template<typename TT>
-inline uint32_t find_pkrm_expansions( const TT& tt, expansion_cache<TT>& cache, uint8_t var_index )
+inline uint32_t find_pkrm_expansions( const TT& tt, expansion_cache<TT>& cache, uint8_t var_index, pkrm_expansion_cache* shared = nullptr )
 {
   /* terminal cases */
   if ( is_const0( tt ) )
@@ -71,6 +308,12 @@ inline uint32_t find_pkrm_expansions( const TT& tt, expansion_cache<TT>& cache,
     return 1;
   }
 
+  /* small sub-functions are handled by the shared cache */
+  if ( use_shared_expansion_cache( tt, var_index, shared ) )
+  {
+    return shared->cost( tt.num_vars() - var_index, compact_sub_function( tt, var_index ) );
+  }
+
   /* already computed */
   const auto it = cache.find( tt );
   if ( it != cache.end() )
@@ -81,36 +324,52 @@ inline uint32_t find_pkrm_expansions( const TT& tt, expansion_cache<TT>& cache,
   const auto tt0 = cofactor0( tt, var_index );
   const auto tt1 = cofactor1( tt, var_index );
 
-  const auto ex0 = find_pkrm_expansions( tt0, cache, var_index + 1 );
-  const auto ex1 = find_pkrm_expansions( tt1, cache, var_index + 1 );
-  const auto ex2 = find_pkrm_expansions( tt0 ^ tt1, cache, var_index + 1 );
-
-  const auto ex_max = std::max( std::max( ex0, ex1 ), ex2 );
+  const auto ex0 = find_pkrm_expansions( tt0, cache, var_index + 1, shared );
+  const auto ex1 = find_pkrm_expansions( tt1, cache, var_index + 1, shared );
+  const auto ex2 = find_pkrm_expansions( tt0 ^ tt1, cache, var_index + 1, shared );
 
-  uint32_t cost{};
-  pkrm_decomposition decomp;
+  const auto result = best_pkrm_decomposition( ex0, ex1, ex2 );
+  cache.insert( {tt, result} );
+  return result.first;
+}
 
-  if ( ex_max == ex0 )
+inline void optimum_pkrm_rec_small( std::unordered_set<kitty::cube, kitty::hash<kitty::cube>>& pkrm, uint32_t num_vars, uint64_t word, pkrm_expansion_cache& shared, uint8_t var_index, const kitty::cube& c )
+{
+  /* terminal cases */
+  if ( word == 0u )
   {
-    cost = ex1 + ex2;
-    decomp = pkrm_decomposition::positive_davio;
+    return;
   }
-  else if ( ex_max == ex1 )
+  if ( word == small_function_mask( num_vars ) )
   {
-    cost = ex0 + ex2;
-    decomp = pkrm_decomposition::negative_davio;
+    add_to_cubes( pkrm, c );
+    return;
   }
-  else
+
+  const auto decomp = shared.lookup( num_vars, word ).second;
+
+  const auto tt0 = compress_even_bits( word );
+  const auto tt1 = compress_even_bits( word >> 1 );
+
+  switch ( decomp )
   {
-    cost = ex0 + ex1;
-    decomp = pkrm_decomposition::shannon;
+  case pkrm_decomposition::positive_davio:
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt0, shared, var_index + 1, c );
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt0 ^ tt1, shared, var_index + 1, with_literal( c, var_index, true ) );
+    break;
+  case pkrm_decomposition::negative_davio:
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt1, shared, var_index + 1, c );
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt0 ^ tt1, shared, var_index + 1, with_literal( c, var_index, false ) );
+    break;
+  case pkrm_decomposition::shannon:
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt0, shared, var_index + 1, with_literal( c, var_index, false ) );
+    optimum_pkrm_rec_small( pkrm, num_vars - 1, tt1, shared, var_index + 1, with_literal( c, var_index, true ) );
+    break;
   }
-  cache.insert( {tt, {cost, decomp}} );
-  return cost;
 }
 
 template<typename TT>
-inline void optimum_pkrm_rec( std::unordered_set<kitty::cube, kitty::hash<kitty::cube>>& pkrm, const TT& tt, const expansion_cache<TT>& cache, uint8_t var_index, const kitty::cube& c )
+inline void optimum_pkrm_rec( std::unordered_set<kitty::cube, kitty::hash<kitty::cube>>& pkrm, const TT& tt, const expansion_cache<TT>& cache, uint8_t var_index, const kitty::cube& c, pkrm_expansion_cache* shared = nullptr )
 {
   /* terminal cases */
   if ( is_const0( tt ) )
@@ -123,6 +382,12 @@ inline void optimum_pkrm_rec( std::unordered_set<kitty::cube, kitty::hash<kitty:
     return;
   }
 
+  if ( use_shared_expansion_cache( tt, var_index, shared ) )
+  {
+    optimum_pkrm_rec_small( pkrm, tt.num_vars() - var_index, compact_sub_function( tt, var_index ), *shared, var_index, c );
+    return;
+  }
+
   const auto& p = cache.at( tt );
 
   const auto tt0 = cofactor0( tt, var_index );
@@ -131,16 +396,16 @@ inline void optimum_pkrm_rec( std::unordered_set<kitty::cube, kitty::hash<kitty:
   switch ( p.second )
   {
   case pkrm_decomposition::positive_davio:
-    optimum_pkrm_rec( pkrm, tt0, cache, var_index + 1, c );
-    optimum_pkrm_rec( pkrm, tt0 ^ tt1, cache, var_index + 1, with_literal( c, var_index, true ) );
+    optimum_pkrm_rec( pkrm, tt0, cache, var_index + 1, c, shared );
+    optimum_pkrm_rec( pkrm, tt0 ^ tt1, cache, var_index + 1, with_literal( c, var_index, true ), shared );
     break;
   case pkrm_decomposition::negative_davio:
-    optimum_pkrm_rec( pkrm, tt1, cache, var_index + 1, c );
-    optimum_pkrm_rec( pkrm, tt0 ^ tt1, cache, var_index + 1, with_literal( c, var_index, false ) );
+    optimum_pkrm_rec( pkrm, tt1, cache, var_index + 1, c, shared );
+    optimum_pkrm_rec( pkrm, tt0 ^ tt1, cache, var_index + 1, with_literal( c, var_index, false ), shared );
     break;
   case pkrm_decomposition::shannon:
-    optimum_pkrm_rec( pkrm, tt0, cache, var_index + 1, with_literal( c, var_index, false ) );
-    optimum_pkrm_rec( pkrm, tt1, cache, var_index + 1, with_literal( c, var_index, true ) );
+    optimum_pkrm_rec( pkrm, tt0, cache, var_index + 1, with_literal( c, var_index, false ), shared );
+    optimum_pkrm_rec( pkrm, tt1, cache, var_index + 1, with_literal( c, var_index, true ), shared );
     break;
   }
 }
@@ -168,6 +433,28 @@ inline esop_t esop_from_optimum_pkrm( const TT& tt )
   return esop_t( cubes.begin(), cubes.end() );
 }
 
+/*! \brief Computes ESOP representation using optimum PKRM with a shared expansion cache
+
+  Same as above, but decompositions of sub-functions with at most 6 variables
+  are looked up in and stored to `shared`, which can be reused across calls
+  and threads.  The cube count may differ slightly from the variant without
+  a shared cache.
+
+  \param tt Truth table
+  \param shared Expansion cache for small sub-functions
+*/
+template<typename TT>
+inline esop_t esop_from_optimum_pkrm( const TT& tt, pkrm_expansion_cache& shared )
+{
+  std::unordered_set<kitty::cube, kitty::hash<kitty::cube>> cubes;
+  detail::expansion_cache<TT> cache;
+
+  detail::find_pkrm_expansions( tt, cache, 0, &shared );
+  detail::optimum_pkrm_rec( cubes, tt, cache, 0, kitty::cube(), &shared );
+
+  return esop_t( cubes.begin(), cubes.end() );
+}
+
 } /* namespace easy::esop */
 
 // Local Variables:
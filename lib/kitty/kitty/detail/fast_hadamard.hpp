@@ -0,0 +1,274 @@
+/* kitty: C++ truth table library
+ * Copyright (C) 2017-2018  EPFL
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use,
+ * copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+ * HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*!
+  \file fast_hadamard.hpp
+  \brief Kernels for the fast Walsh-Hadamard transform
+
+  \author Mathias Soeken
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ) )
+#define KITTY_HAS_AVX2_KERNELS 1
+#include <immintrin.h>
+#else
+#define KITTY_HAS_AVX2_KERNELS 0
+#endif
+
+namespace kitty
+{
+
+namespace detail
+{
+
+/* number of coefficients that are transformed together before the
+   butterflies with larger strides are applied (fits into L1 cache) */
+constexpr uint64_t fwht_block_size = uint64_t( 1 ) << 12;
+
+/* all coefficients of an n-variable function are in [-2^n, 2^n], therefore
+   16-bit integers are sufficient for up to 14 variables */
+constexpr uint32_t fwht_int16_max_vars = 14u;
+
+template<typename T>
+inline void fwht_strides_scalar( T* s, uint64_t size, uint64_t from, uint64_t to )
+{
+  for ( auto m = from; m < to; m <<= 1u )
+  {
+    for ( uint64_t i = 0u; i < size; i += ( m << 1u ) )
+    {
+      for ( uint64_t j = i, k = i + m; j < i + m; ++j, ++k )
+      {
+        const T t = s[j];
+        s[j] += s[k];
+        s[k] = t - s[k];
+      }
+    }
+  }
+}
+
+template<typename T>
+inline void fwht_scalar( T* s, uint64_t size )
+{
+  fwht_strides_scalar( s, size, 1u, size );
+}
+
+/* writes +1 for every 0-bit and -1 for every 1-bit of the truth table */
+template<typename T, typename TT>
+inline void signs_from_truth_table_scalar( const TT& tt, T* s )
+{
+  const auto num_bits = tt.num_bits();
+  uint64_t i = 0u;
+  for ( auto it = tt.cbegin(); it != tt.cend() && i < num_bits; ++it )
+  {
+    const auto word = *it;
+    for ( auto b = 0u; b < 64u && i < num_bits; ++b, ++i )
+    {
+      s[i] = static_cast<T>( 1 - 2 * static_cast<int>( ( word >> b ) & 1u ) );
+    }
+  }
+}
+
+#if KITTY_HAS_AVX2_KERNELS
+inline bool has_avx2()
+{
+  static const bool supported = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports( "avx2" ) != 0;
+  }();
+  return supported;
+}
+
+/* butterflies with strides 1, 2, and 4 inside one vector of 8 coefficients */
+__attribute__( ( target( "avx2" ) ) ) inline __m256i fwht_in_register_epi32( __m256i v )
+{
+  auto w = _mm256_shuffle_epi32( v, 0xb1 );
+  v = _mm256_blend_epi32( _mm256_add_epi32( v, w ), _mm256_sub_epi32( w, v ), 0xaa );
+  w = _mm256_shuffle_epi32( v, 0x4e );
+  v = _mm256_blend_epi32( _mm256_add_epi32( v, w ), _mm256_sub_epi32( w, v ), 0xcc );
+  w = _mm256_permute2x128_si256( v, v, 0x01 );
+  return _mm256_blend_epi32( _mm256_add_epi32( v, w ), _mm256_sub_epi32( w, v ), 0xf0 );
+}
+
+/* butterflies with strides 1, 2, 4, and 8 inside one vector of 16 coefficients */
+__attribute__( ( target( "avx2" ) ) ) inline __m256i fwht_in_register_epi16( __m256i v )
+{
+  const auto swap_words = _mm256_setr_epi8( 2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                            2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13 );
+  auto w = _mm256_shuffle_epi8( v, swap_words );
+  v = _mm256_blend_epi16( _mm256_add_epi16( v, w ), _mm256_sub_epi16( w, v ), 0xaa );
+  w = _mm256_shuffle_epi32( v, 0xb1 );
+  v = _mm256_blend_epi16( _mm256_add_epi16( v, w ), _mm256_sub_epi16( w, v ), 0xcc );
+  w = _mm256_shuffle_epi32( v, 0x4e );
+  v = _mm256_blend_epi16( _mm256_add_epi16( v, w ), _mm256_sub_epi16( w, v ), 0xf0 );
+  w = _mm256_permute2x128_si256( v, v, 0x01 );
+  return _mm256_blend_epi32( _mm256_add_epi16( v, w ), _mm256_sub_epi16( w, v ), 0xf0 );
+}
+
+/* butterflies with strides in [from, to), all strides must be multiples of
+   the vector width */
+template<bool Int16>
+__attribute__( ( target( "avx2" ) ) ) inline void fwht_strides_avx2( void* data, uint64_t size, uint64_t from, uint64_t to )
+{
+  constexpr uint64_t lanes = Int16 ? 16u : 8u;
+  auto* s = static_cast<char*>( data );
+  constexpr uint64_t elem = Int16 ? 2u : 4u;
+
+  for ( auto m = from; m < to; m <<= 1u )
+  {
+    for ( uint64_t i = 0u; i < size; i += ( m << 1u ) )
+    {
+      for ( uint64_t j = i; j < i + m; j += lanes )
+      {
+        auto* pj = reinterpret_cast<__m256i*>( s + j * elem );
+        auto* pk = reinterpret_cast<__m256i*>( s + ( j + m ) * elem );
+        const auto a = _mm256_loadu_si256( pj );
+        const auto b = _mm256_loadu_si256( pk );
+        if constexpr ( Int16 )
+        {
+          _mm256_storeu_si256( pj, _mm256_add_epi16( a, b ) );
+          _mm256_storeu_si256( pk, _mm256_sub_epi16( a, b ) );
+        }
+        else
+        {
+          _mm256_storeu_si256( pj, _mm256_add_epi32( a, b ) );
+          _mm256_storeu_si256( pk, _mm256_sub_epi32( a, b ) );
+        }
+      }
+    }
+  }
+}
+
+/* cache-blocked transform, size must be a multiple of the vector width */
+template<bool Int16>
+__attribute__( ( target( "avx2" ) ) ) inline void fwht_avx2( void* data, uint64_t size )
+{
+  constexpr uint64_t lanes = Int16 ? 16u : 8u;
+  constexpr uint64_t elem = Int16 ? 2u : 4u;
+  auto* s = static_cast<char*>( data );
+  const auto block = size < fwht_block_size ? size : fwht_block_size;
+
+  for ( uint64_t b = 0u; b < size; b += block )
+  {
+    for ( uint64_t j = b; j < b + block; j += lanes )
+    {
+      auto* p = reinterpret_cast<__m256i*>( s + j * elem );
+      const auto v = _mm256_loadu_si256( p );
+      _mm256_storeu_si256( p, Int16 ? fwht_in_register_epi16( v ) : fwht_in_register_epi32( v ) );
+    }
+    fwht_strides_avx2<Int16>( s + b * elem, block, lanes, block );
+  }
+  fwht_strides_avx2<Int16>( s, size, block, size );
+}
+
+/* expands 8 (16) truth table bits into +1/-1 coefficients at a time */
+template<bool Int16, typename TT>
+__attribute__( ( target( "avx2" ) ) ) inline void signs_from_truth_table_avx2( const TT& tt, void* data )
+{
+  constexpr uint64_t lanes = Int16 ? 16u : 8u;
+  constexpr uint64_t elem = Int16 ? 2u : 4u;
+  auto* s = static_cast<char*>( data );
+
+  const auto bits = Int16 ? _mm256_setr_epi16( 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, -32768 )
+                          : _mm256_setr_epi32( 1, 2, 4, 8, 16, 32, 64, 128 );
+  const auto one = Int16 ? _mm256_set1_epi16( 1 ) : _mm256_set1_epi32( 1 );
+
+  uint64_t i = 0u;
+  for ( auto it = tt.cbegin(); it != tt.cend(); ++it )
+  {
+    const uint64_t word = *it;
+    for ( uint64_t b = 0u; b < 64u; b += lanes, i += lanes )
+    {
+      const auto chunk = static_cast<int32_t>( ( word >> b ) & ( ( uint64_t( 1 ) << lanes ) - 1u ) );
+      __m256i mask;
+      if constexpr ( Int16 )
+      {
+        const auto v = _mm256_set1_epi16( static_cast<int16_t>( chunk ) );
+        mask = _mm256_cmpeq_epi16( _mm256_and_si256( v, bits ), bits );
+      }
+      else
+      {
+        const auto v = _mm256_set1_epi32( chunk );
+        mask = _mm256_cmpeq_epi32( _mm256_and_si256( v, bits ), bits );
+      }
+      /* -1 | 1 = -1 and 0 | 1 = 1 */
+      _mm256_storeu_si256( reinterpret_cast<__m256i*>( s + i * elem ), _mm256_or_si256( mask, one ) );
+    }
+  }
+}
+#endif
+
+/*! \brief Computes the (unnormalized) Walsh-Hadamard transform in place */
+inline void fast_hadamard_transform_inplace( std::vector<int32_t>& s )
+{
+#if KITTY_HAS_AVX2_KERNELS
+  if ( s.size() >= 8u && has_avx2() )
+  {
+    fwht_avx2<false>( s.data(), s.size() );
+    return;
+  }
+#endif
+  fwht_scalar( s.data(), s.size() );
+}
+
+/*! \brief Returns the Walsh-Hadamard transform of the +1/-1 encoding of a truth table */
+template<typename TT>
+inline std::vector<int32_t> fast_hadamard_transform_of_truth_table( const TT& tt )
+{
+  const uint64_t size = tt.num_bits();
+  std::vector<int32_t> s( size );
+
+#if KITTY_HAS_AVX2_KERNELS
+  if ( size >= 64u && has_avx2() )
+  {
+    if ( static_cast<uint32_t>( tt.num_vars() ) <= fwht_int16_max_vars )
+    {
+      std::vector<int16_t> s16( size );
+      signs_from_truth_table_avx2<true>( tt, s16.data() );
+      fwht_avx2<true>( s16.data(), size );
+      std::copy( s16.begin(), s16.end(), s.begin() );
+    }
+    else
+    {
+      signs_from_truth_table_avx2<false>( tt, s.data() );
+      fwht_avx2<false>( s.data(), size );
+    }
+    return s;
+  }
+#endif
+
+  signs_from_truth_table_scalar( tt, s.data() );
+  fwht_scalar( s.data(), size );
+  return s;
+}
+
+} // namespace detail
+
+} // namespace kitty
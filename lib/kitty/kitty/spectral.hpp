@@ -39,6 +39,7 @@
 #pragma once
 
 #include "bit_operations.hpp"
+#include "detail/fast_hadamard.hpp"
 #include "detail/mscfix.hpp"
 
 #include <cmath>
@@ -73,21 +74,7 @@ struct spectral_operation
 
 inline void fast_hadamard_transform( std::vector<int32_t>& s, bool reverse = false )
 {
-  unsigned k{};
-  int t{};
-
-  for ( auto m = 1u; m < s.size(); m <<= 1u )
-  {
-    for ( auto i = 0u; i < s.size(); i += ( m << 1u ) )
-    {
-      for ( auto j = i, p = k = i + m; j < p; ++j, ++k )
-      {
-        t = s[j];
-        s[j] += s[k];
-        s[k] = t - s[k];
-      }
-    }
-  }
+  fast_hadamard_transform_inplace( s );
 
   if ( reverse )
   {
@@ -129,10 +116,7 @@ public:
   template<typename TT>
   static spectrum from_truth_table( const TT& tt )
   {
-    std::vector<int32_t> _s( tt.num_bits(), 1 );
-    for_each_one_bit( tt, [&_s]( auto bit ) { _s[bit] = -1; } );
-    fast_hadamard_transform( _s );
-    return spectrum( _s );
+    return spectrum( fast_hadamard_transform_of_truth_table( tt ) );
   }
 
   template<typename TT>
@@ -10,11 +10,18 @@
 #include "../../networks/qubit.hpp"
 #include "../../utils/bit_matrix_rm.hpp"
 #include "../../utils/dynamic_bitset.hpp"
+#include "../../utils/parallel_for.hpp"
+#include "../../utils/permute.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <cstdint>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace tweedledum {
@@ -128,8 +135,155 @@ struct cnot_patel_params {
 	bool best_partition_size = false;
 	/*! \brief Partition size */
 	uint32_t partition_size = 1u;
+	/*! \brief Maximum number of row permutations that are evaluated when rewiring is allowed.
+	 *
+	 * If there are at most that many permutations, all of them are evaluated.  Otherwise, the
+	 * permutations are searched with simulated annealing, starting from the identity.
+	 */
+	uint32_t rewiring_iterations = 1024u;
+	/*! \brief Time limit in seconds for the rewiring search (0 means no limit). */
+	double rewiring_time_limit = 0.0;
+	/*! \brief Number of threads that evaluate permutations (0 means hardware concurrency). */
+	uint32_t num_threads = 1u;
+	/*! \brief Seed for the rewiring search. */
+	uint32_t seed = 0u;
 };
 
+namespace detail {
+
+/* Returns the smallest number of gates, and the first partition size in [min_ps, max_ps) that
+ * achieves it (min_ps is always tried) */
+template<class Network, class Matrix>
+std::pair<uint32_t, uint32_t> cnot_patel_best_partition(Network& network,
+                                                        std::vector<qubit_id> const& qubits,
+                                                        Matrix const& matrix, uint32_t min_ps,
+                                                        uint32_t max_ps)
+{
+	auto best = std::make_pair(std::numeric_limits<uint32_t>::max(), min_ps);
+	auto ps = min_ps;
+	do {
+		cnot_patel_ftor synthesizer(network, qubits, matrix, ps);
+		const uint32_t num_gates = synthesizer.synthesize(false);
+		if (num_gates < best.first) {
+			best = {num_gates, ps};
+		}
+		++ps;
+	} while (ps < max_ps);
+	return best;
+}
+
+/* Searches for a row permutation with few gates.  Permutations are evaluated in batches, such
+ * that the result does not depend on the number of threads. */
+template<class Network, class Matrix>
+std::pair<std::vector<uint32_t>, uint32_t>
+cnot_patel_rewiring_search(Network& network, std::vector<qubit_id> const& qubits,
+                           Matrix const& matrix, uint32_t min_ps, uint32_t max_ps,
+                           cnot_patel_params const& params)
+{
+	constexpr uint32_t batch_size = 64u;
+	const uint32_t num_rows = matrix.num_rows();
+	const auto start = std::chrono::steady_clock::now();
+	const auto out_of_time = [&]() {
+		return params.rewiring_time_limit > 0.0
+		       && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+		              >= params.rewiring_time_limit;
+	};
+
+	std::vector<std::vector<uint32_t>> batch;
+	std::vector<std::pair<uint32_t, uint32_t>> results;
+	const auto evaluate_batch = [&]() {
+		results.resize(batch.size());
+		parallel_for(static_cast<uint32_t>(batch.size()), [&](uint32_t i) {
+			results[i] = cnot_patel_best_partition(network, qubits,
+			                                       matrix.permute_rows(batch[i]), min_ps,
+			                                       max_ps);
+		}, params.num_threads);
+	};
+
+	std::vector<uint32_t> best_permutation(num_rows);
+	std::iota(best_permutation.begin(), best_permutation.end(), 0u);
+	auto best = std::make_pair(std::numeric_limits<uint32_t>::max(), min_ps);
+
+	// Evaluate all permutations, if there are not too many of them
+	uint64_t num_permutations = 1u;
+	for (auto i = 2u; i <= num_rows && num_permutations <= params.rewiring_iterations; ++i) {
+		num_permutations *= i;
+	}
+	if (num_permutations <= params.rewiring_iterations) {
+		auto permutation = best_permutation;
+		auto more = true;
+		while (more) {
+			batch.clear();
+			while (more && batch.size() < batch_size) {
+				batch.push_back(permutation);
+				more = std::next_permutation(permutation.begin(), permutation.end());
+			}
+			evaluate_batch();
+			for (auto i = 0u; i < batch.size(); ++i) {
+				if (results[i].first < best.first) {
+					best = results[i];
+					best_permutation = batch[i];
+				}
+			}
+			if (out_of_time()) {
+				break;
+			}
+		}
+		return {best_permutation, best.second};
+	}
+
+	// Simulated annealing: each round evaluates random transpositions of the current
+	// permutation, and moves to the best of them, if it is not worse, or with a probability
+	// that decreases with the temperature
+	std::mt19937 rng(params.seed);
+	std::uniform_int_distribution<uint32_t> row_dist(0u, num_rows - 1u);
+	std::uniform_real_distribution<double> accept_dist(0.0, 1.0);
+
+	best = cnot_patel_best_partition(network, qubits, matrix, min_ps, max_ps);
+	auto current_permutation = best_permutation;
+	auto current_num_gates = best.first;
+	const auto initial_temperature = std::max(1.0, 0.05 * current_num_gates);
+	auto num_evaluated = 1u;
+	while (num_evaluated < params.rewiring_iterations && !out_of_time()) {
+		batch.clear();
+		while (batch.size() < std::min(batch_size, params.rewiring_iterations - num_evaluated)) {
+			auto permutation = current_permutation;
+			const auto i = row_dist(rng);
+			auto j = row_dist(rng);
+			while (j == i) {
+				j = row_dist(rng);
+			}
+			std::swap(permutation[i], permutation[j]);
+			batch.push_back(std::move(permutation));
+		}
+		evaluate_batch();
+		num_evaluated += batch.size();
+
+		auto candidate = 0u;
+		for (auto i = 1u; i < batch.size(); ++i) {
+			if (results[i].first < results[candidate].first) {
+				candidate = i;
+			}
+		}
+		if (results[candidate].first < best.first) {
+			best = results[candidate];
+			best_permutation = batch[candidate];
+		}
+
+		const auto temperature = initial_temperature
+		                         * (1.0 - double(num_evaluated) / params.rewiring_iterations);
+		const auto delta = double(results[candidate].first) - current_num_gates;
+		if (delta <= 0.0
+		    || (temperature > 0.0 && accept_dist(rng) < std::exp(-delta / temperature))) {
+			current_permutation = std::move(batch[candidate]);
+			current_num_gates = results[candidate].first;
+		}
+	}
+	return {best_permutation, best.second};
+}
+
+} // namespace detail
+
 /*! \brief CNOT Patel synthesis for linear circuits
  *
  * This is the in-place variant of ``cnot_patel``, in which the network is passed as a parameter
@@ -160,33 +314,14 @@ void cnot_patel(Network& network, std::vector<qubit_id> const& qubits, Matrix co
 		return;
 	}
 
+	// patterns of a partition are stored in 32-bit integers
 	auto const min_ps = params.best_partition_size ? 1u : params.partition_size;
-	auto const max_ps = params.best_partition_size ? matrix.num_rows() : params.partition_size;
-	auto const old_num_gates = network.num_gates();
-	(void)old_num_gates; /* var not used in Release mode */
-	auto best_num_gates = std::numeric_limits<uint32_t>::max();
+	auto const max_ps = params.best_partition_size ? std::min<uint32_t>(matrix.num_rows(), 32u) :
+	                                                 params.partition_size;
 
 	if (params.allow_rewiring == true) {
-		auto best_ps = min_ps;
-		std::vector<uint32_t> best_permutation(qubits.size());
-		std::iota(best_permutation.begin(), best_permutation.end(), 0u);
-
-		auto permutation = best_permutation;
-		do {
-			auto permuted_matrix = matrix.permute_rows(permutation);
-			auto ps = min_ps;
-			do {
-				detail::cnot_patel_ftor synthesizer(network, qubits, permuted_matrix, ps);
-				const auto num_gates = synthesizer.synthesize(false);
-				if (num_gates < best_num_gates) {
-					best_num_gates = num_gates;
-					best_ps = ps;
-					best_permutation = permutation;
-				}
-				++ps;
-				assert(network.num_gates() == old_num_gates);
-			} while (ps < max_ps);
-		} while (std::next_permutation(permutation.begin(), permutation.end()));
+		auto const [best_permutation, best_ps]
+		    = detail::cnot_patel_rewiring_search(network, qubits, matrix, min_ps, max_ps, params);
 
 		auto permuted_matrix = matrix.permute_rows(best_permutation);
 		detail::cnot_patel_ftor synthesizer(network, qubits, permuted_matrix, best_ps);
@@ -199,18 +334,8 @@ void cnot_patel(Network& network, std::vector<qubit_id> const& qubits, Matrix co
 		}
 		network.rewire(transpositions);
 	} else {
-		auto best_ps = min_ps;
-		auto ps = min_ps;
-		do {
-			detail::cnot_patel_ftor synthesizer(network, qubits, matrix, ps);
-			const auto num_gates = synthesizer.synthesize(false);
-			if (num_gates < best_num_gates) {
-				best_num_gates = num_gates;
-				best_ps = ps;
-			}
-			++ps;
-			assert(network.num_gates() == old_num_gates);
-		} while (ps < max_ps);
+		auto const best_ps
+		    = detail::cnot_patel_best_partition(network, qubits, matrix, min_ps, max_ps).second;
 		detail::cnot_patel_ftor synthesizer(network, qubits, matrix, best_ps);
 		synthesizer.synthesize();
 	}
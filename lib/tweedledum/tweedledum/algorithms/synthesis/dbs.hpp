@@ -36,15 +36,23 @@ auto decompose(std::vector<uint32_t>& permutation, uint8_t var)
 	std::vector<uint32_t> left(permutation.size(), 0);
 	std::vector<uint32_t> right(permutation.size(), 0);
 	std::vector<uint8_t> visited(permutation.size(), 0);
+	std::vector<uint32_t> inverse(permutation.size());
+	for (uint32_t row = 0; row < permutation.size(); ++row) {
+		inverse[permutation[row]] = row;
+	}
 
+	/* rows are never unvisited again, so all rows before the cursor are visited */
+	uint32_t next_unvisited = 0u;
 	uint32_t row = 0u;
 	while (true) {
 		if (visited[row]) {
-			const auto it = std::find(visited.begin(), visited.end(), 0);
-			if (it == visited.end()) {
+			while (next_unvisited < visited.size() && visited[next_unvisited]) {
+				++next_unvisited;
+			}
+			if (next_unvisited == visited.size()) {
 				break;
 			}
-			row = std::distance(visited.begin(), it);
+			row = next_unvisited;
 		}
 
 		/* assign 0 to var on left side */
@@ -62,8 +70,7 @@ auto decompose(std::vector<uint32_t>& permutation, uint8_t var)
 		/* assign 0 to var on left side */
 		right[permutation[row] & ~(1 << var)] = permutation[row] ^ (1 << var);
 
-		row = std::distance(permutation.begin(),
-		                    std::find(permutation.begin(), permutation.end(), permutation[row] ^ (1 << var)));
+		row = inverse[permutation[row] ^ (1 << var)];
 	}
 
 	std::vector<uint32_t> perm_old = permutation;
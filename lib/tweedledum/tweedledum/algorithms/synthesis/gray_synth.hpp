@@ -7,7 +7,6 @@
 
 #include "../../gates/gate_set.hpp"
 #include "../../networks/qubit.hpp"
-#include "../../utils/bit_matrix_cm.hpp"
 #include "../../utils/bit_matrix_rm.hpp"
 #include "../../utils/dynamic_bitset.hpp"
 #include "../../utils/parity_terms.hpp"
@@ -33,10 +32,13 @@ struct gray_synth_params {
 
 namespace detail {
 
-template<class Network>
+template<class Network, class Term>
 class gray_synth_ftor {
-	using matrix_type = bit_matrix_cm<uint32_t>;
+	/* Parity terms are stored in the columns of a row-major matrix, such that the CNOT updates
+	 * are word-wide row XORs and the cofactor checks do not allocate */
+	using matrix_type = bit_matrix_rm<uint64_t>;
 	using qubit_pair_type = std::pair<uint32_t, uint32_t>;
+	using term_traits = parity_term_traits<Term>;
 
 	struct state_type {
 		std::vector<uint32_t> selected_columns;
@@ -46,15 +48,21 @@ class gray_synth_ftor {
 
 public:
 	gray_synth_ftor(Network& network, std::vector<qubit_id> const& qubits,
-	                parity_terms const& parities, gray_synth_params params)
+	                parity_terms<Term> const& parities, gray_synth_params params)
 	    : network_(network)
 	    , qubits_(qubits)
 	    , parities_(parities)
-	    , parity_matrix_(num_qubits())
+	    , parity_matrix_(num_qubits(), parities.num_terms())
 	    , parameters_(params)
 	{
+		uint32_t column_index = 0u;
 		for (auto const& [term, angle] : parities) {
-			parity_matrix_.emplace_back_column(term);
+			for (auto row_index = 0u; row_index < num_qubits(); ++row_index) {
+				if (term_traits::contains(term, row_index)) {
+					parity_matrix_.at(row_index, column_index) = 1;
+				}
+			}
+			++column_index;
 			(void) angle;
 		}
 		std::vector<uint32_t> selected_columns(parity_matrix_.num_columns());
@@ -78,17 +86,16 @@ public:
 					if (j == state.qid) {
 						continue;
 					}
-					if (!parity_matrix_.row(state.selected_columns, j).all()) {
+					if (!parity_matrix_.row_all(state.selected_columns, j)) {
 						continue;
 					}
-					parity_matrix_.foreach_column([&](auto& column) {
-						column[j] ^= column[state.qid]; 
-					});
+					parity_matrix_.row(j) ^= parity_matrix_.row(state.qid);
 					gates.emplace_back(j, state.qid);
 				}
 			}
 
-			if (state.selected_columns.size() == 1 && parity_matrix_.column(state.selected_columns[0]).count() <= 1) {
+			if (state.selected_columns.size() == 1
+			    && parity_matrix_.column_count(state.selected_columns[0]) <= 1) {
 				continue;
 			}
 			if (state.remaining_rows.count() == 0) {
@@ -98,14 +105,14 @@ public:
 			auto row_index = select_row(state.selected_columns, state.remaining_rows);
 			std::vector<uint32_t> cofactor0;
 			std::vector<uint32_t> cofactor1;
-			parity_matrix_.foreach_column(state.selected_columns,
-			[&](auto& column, auto column_index) {
-				if (column[row_index] == 1) {
+			auto const& row = parity_matrix_.row(row_index);
+			for (auto column_index : state.selected_columns) {
+				if (row[column_index]) {
 					cofactor1.push_back(column_index);
-					return;
+					continue;
 				}
 				cofactor0.push_back(column_index);
-			});
+			}
 
 			state.remaining_rows[row_index] = 0;
 			if (!cofactor1.empty()) {
@@ -123,9 +130,9 @@ public:
 		// Initialize the parity of each qubit state
 		// Applying phase gate to parities that consisting of just one variable
 		// i is the index of the target
-		std::vector<uint32_t> qubits_states;
+		std::vector<Term> qubits_states;
 		for (auto i = 0u; i < num_qubits(); ++i) {
-			qubits_states.emplace_back((1u << i));
+			qubits_states.emplace_back(term_traits::unit(num_qubits(), i));
 			auto rotation_angle = parities_.extract_term(qubits_states[i]);
 			if (rotation_angle != 0.0) {
 				network_.add_gate(gate_base(gate_set::rotation_z, rotation_angle),
@@ -172,9 +179,8 @@ private:
 			if (remaining_rows[i] == 0) {
 				continue;
 			}
-			const auto row = parity_matrix_.row(selected_columns, i);
-			const auto num_ones = row.count();
-			const auto num_zeros = row.size() - num_ones; // Always >= 0
+			const auto num_ones = parity_matrix_.row_count(selected_columns, i);
+			const auto num_zeros = selected_columns.size() - num_ones; // Always >= 0
 			const auto local_max = std::max(num_ones, num_zeros);
 			if (local_max > max) {
 				max = local_max;
@@ -187,7 +193,7 @@ private:
 private:
 	Network& network_;
 	std::vector<qubit_id> qubits_;
-	parity_terms parities_;
+	parity_terms<Term> parities_;
 	matrix_type parity_matrix_;
 	std::vector<state_type> state_stack_;
 	gray_synth_params parameters_;
@@ -207,11 +213,11 @@ private:
  * \param params   The parameters that configure the synthesis process.
  *                 See `gray_synth_params` for details.
  */
-template<class Network>
+template<class Network, class Term>
 void gray_synth(Network& network, std::vector<qubit_id> const& qubits,
-                parity_terms const& parities, gray_synth_params params = {})
+                parity_terms<Term> const& parities, gray_synth_params params = {})
 {
-	assert(qubits.size() <= 32u);
+	assert(qubits.size() <= parity_term_traits<Term>::max_num_qubits);
 	if (parities.num_terms() == 0u) {
 		return;
 	}
@@ -228,7 +234,8 @@ void gray_synth(Network& network, std::vector<qubit_id> const& qubits,
    \endverbatim
  *
  * \param num_qubits Number of qubits
- * \param parities   List of parities and rotation angles to synthesize
+ * \param parities   List of parities and rotation angles to synthesize, for more than 32
+ *                   qubits use terms of type `uint64_t` or `dynamic_bitset`
  * \param params     The parameters that configure the synthesis process.
  *                   See `gray_synth_params` for details.
  * 
@@ -238,10 +245,11 @@ void gray_synth(Network& network, std::vector<qubit_id> const& qubits,
  * \algexpects List of parities and rotation angles to synthesize
  * \algreturns {CNOT, Rz} network
  */
-template<class Network>
-Network gray_synth(uint32_t num_qubits, parity_terms const& parities, gray_synth_params params = {})
+template<class Network, class Term>
+Network gray_synth(uint32_t num_qubits, parity_terms<Term> const& parities,
+                   gray_synth_params params = {})
 {
-	assert(num_qubits <= 32);
+	assert(num_qubits <= parity_term_traits<Term>::max_num_qubits);
 	Network network;
 	for (auto i = 0u; i < num_qubits; ++i) {
 		network.add_qubit();
@@ -12,9 +12,9 @@
 
 #include <algorithm>
 #include <cassert>
-#include <cmath>
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <numeric>
 #include <tuple>
 #include <vector>
@@ -22,40 +22,67 @@
 namespace tweedledum {
 namespace detail {
 
+/* linear synthesis visits every parity, hence the angles are looked up in a table that is indexed
+ * by the parity, extracted angles are set to zero */
+inline std::vector<angle> linear_synth_angles(uint32_t num_qubits, parity_terms<> const& parities)
+{
+	std::vector<angle> angles(1u << num_qubits, angle(0.0));
+	for (auto const& [term, rotation_angle] : parities) {
+		if (term < angles.size()) {
+			angles[term] = rotation_angle;
+		}
+	}
+	return angles;
+}
+
+inline angle extract_angle(std::vector<angle>& angles, uint32_t term)
+{
+	const auto rotation_angle = angles[term];
+	angles[term] = angle(0.0);
+	return rotation_angle;
+}
+
 template<class Network>
-void linear_synth_binary(Network& network, std::vector<qubit_id> const& qubits, parity_terms parities)
+void linear_synth_binary(Network& network, std::vector<qubit_id> const& qubits,
+                         parity_terms<> const& parities)
 {
-	const auto num_qubits = qubits.size();
+	const uint32_t num_qubits = qubits.size();
+	auto angles = linear_synth_angles(num_qubits, parities);
 
 	// Initialize the parity of each qubit state
 	// Applying phase gate to parities that consisting of just one variable
 	// i is the index of the target
+	// The parities of the qubits are linearly independent, and hence distinct, such that
+	// qubit_of_state maps each current parity to its qubit
+	constexpr auto no_qubit = std::numeric_limits<uint8_t>::max();
+	std::vector<uint8_t> qubit_of_state(1u << num_qubits, no_qubit);
 	std::vector<uint32_t> qubits_states;
 	for (auto i = 0u; i < num_qubits; ++i) {
 		qubits_states.emplace_back((1u << i));
-		auto rotation_angle = parities.extract_term(qubits_states[i]);
+		qubit_of_state[1u << i] = i;
+		auto rotation_angle = extract_angle(angles, qubits_states[i]);
 		if (rotation_angle != 0.0) {
 			network.add_gate(gate_base(gate_set::rotation_z, rotation_angle), qubits[i]);
 		}
 	}
 
 	// Synthesize the network
+	// The target is the most significant variable of the parity i, the control is the qubit
+	// whose parity together with the parity of the target is i
 	for (auto i = 1u; i < (1u << num_qubits); i++) {
-		if ((i ^ (1 << (i - 1))) == 0) {
+		const uint32_t target = 31u - __builtin_clz(i);
+		const auto control = qubit_of_state[i ^ qubits_states[target]];
+		if (control == no_qubit) {
 			continue;
 		}
-		uint32_t first_num = std::floor(std::log2(i));
-		for (auto j = 0u; j < num_qubits; j++) {
-			if ((first_num != j) && ((qubits_states[j] ^ qubits_states[first_num]) == i)) {
-				qubits_states[first_num] ^= qubits_states[j];
-				network.add_gate(gate::cx, qubits[j], qubits[first_num]);
-				auto rotation_angle = parities.extract_term(qubits_states[first_num]);
-				if (rotation_angle != 0.0) {
-					network.add_gate(gate_base(gate_set::rotation_z,
-					                           rotation_angle),
-					                 qubits[first_num]);
-				}
-			}
+		qubit_of_state[qubits_states[target]] = no_qubit;
+		qubit_of_state[i] = target;
+		qubits_states[target] = i;
+		network.add_gate(gate::cx, qubits[control], qubits[target]);
+		auto rotation_angle = extract_angle(angles, i);
+		if (rotation_angle != 0.0) {
+			network.add_gate(gate_base(gate_set::rotation_z, rotation_angle),
+			                 qubits[target]);
 		}
 	}
 
@@ -66,15 +93,14 @@ void linear_synth_binary(Network& network, std::vector<qubit_id> const& qubits,
 }
 
 template<class Network>
-void linear_synth_gray(Network& network, std::vector<qubit_id> const& qubits, parity_terms parities)
+void linear_synth_gray(Network& network, std::vector<qubit_id> const& qubits,
+                         parity_terms<> const& parities)
 {
-	const auto num_qubits = qubits.size();
-
-	// Generate Gray code
-	std::vector<uint32_t> gray_code;
-	for (auto i = 0u; i < (1u << num_qubits); ++i) {
-		gray_code.emplace_back((i >> 1) ^ i);
+	const uint32_t num_qubits = qubits.size();
+	if (num_qubits == 0u) {
+		return;
 	}
+	auto angles = linear_synth_angles(num_qubits, parities);
 
 	// Initialize the parity of each qubit state
 	// Applying phase gate to parities that consisting of just one variable
@@ -82,32 +108,30 @@ void linear_synth_gray(Network& network, std::vector<qubit_id> const& qubits, pa
 	std::vector<uint32_t> qubits_states;
 	for (auto i = 0u; i < num_qubits; ++i) {
 		qubits_states.emplace_back((1u << i));
-		auto rotation_angle = parities.extract_term(qubits_states[i]);
+		auto rotation_angle = extract_angle(angles, qubits_states[i]);
 		if (rotation_angle != 0.0) {
 			network.add_gate(gate_base(gate_set::rotation_z, rotation_angle), qubits[i]);
 		}
 	}
 
+	auto add_cnot = [&](uint32_t control, uint32_t target) {
+		qubits_states[target] ^= qubits_states[control];
+		network.add_gate(gate::cx, qubits[control], qubits[target]);
+		auto rotation_angle = extract_angle(angles, qubits_states[target]);
+		if (rotation_angle != 0.0) {
+			network.add_gate(gate_base(gate_set::rotation_z, rotation_angle),
+			                 qubits[target]);
+		}
+	};
+
 	// Synthesize the network
-	// i is the index of the target
+	// i is the index of the target, the controls follow the Gray code: the codes of j - 1 and j
+	// differ in bit ctz(j), and the codes of 2^i and 2^(i + 1) - 1 differ in bit i - 1
 	for (auto i = num_qubits - 1u; i > 0; --i) {
 		for (auto j = (1u << (i + 1)) - 1u; j > (1u << i); --j) {
-			const auto temp = std::log2(gray_code[j] ^ gray_code[j - 1u]);
-			qubits_states[i] ^= qubits_states[temp];
-			network.add_gate(gate::cx, qubits[temp], qubits[i]);
-			auto rotation_angle = parities.extract_term(qubits_states[i]);
-			if (rotation_angle != 0.0) {
-				network.add_gate(gate_base(gate_set::rotation_z, rotation_angle),
-				                 qubits[i]);
-			}
-		}
-		const auto temp = std::log2(gray_code[1 << i] ^ gray_code[(1u << (i + 1)) - 1u]);
-		qubits_states[i] ^= qubits_states[temp];
-		network.add_gate(gate::cx, qubits[temp], qubits[i]);
-		auto rotation_angle = parities.extract_term(qubits_states[i]);
-		if (rotation_angle != 0.0) {
-			network.add_gate(gate_base(gate_set::rotation_z, rotation_angle), qubits[i]);
+			add_cnot(__builtin_ctz(j), i);
 		}
+		add_cnot(i - 1u, i);
 	}
 }
 
@@ -135,9 +159,9 @@ struct linear_synth_params {
  */
 template<class Network>
 void linear_synth(Network& network, std::vector<qubit_id> const& qubits,
-                  parity_terms const& parities, linear_synth_params params = {})
+                  parity_terms<> const& parities, linear_synth_params params = {})
 {
-	assert(qubits.size() <= 6);
+	assert(qubits.size() < 32u);
 	switch (params.strategy) {
 		case linear_synth_params::strategy::binary:
 			detail::linear_synth_binary(network, qubits, parities);
@@ -164,10 +188,10 @@ void linear_synth(Network& network, std::vector<qubit_id> const& qubits,
  * \algreturns {CNOT, Rz} network
  */
 template<class Network>
-Network linear_synth(uint32_t num_qubits, parity_terms const& parities,
+Network linear_synth(uint32_t num_qubits, parity_terms<> const& parities,
                      linear_synth_params params = {})
 {
-	assert(num_qubits <= 6);
+	assert(num_qubits < 32u);
 	Network network;
 	for (auto i = 0u; i < num_qubits; ++i) {
 		network.add_qubit();
@@ -68,11 +68,24 @@ struct stg_from_exact_esop {
 	}
 };
 
+/*! \brief Parameters for `stg_from_pkrm`. */
+struct stg_from_pkrm_params {
+	/*! \brief Expansion cache that is shared across calls (not used if `nullptr`).
+	 *
+	 * The cache must outlive the synthesis function and its copies.
+	 */
+	easy::esop::pkrm_expansion_cache* expansion_cache = nullptr;
+};
+
 /*! \brief Synthesize a quantum network from a function by computing PKRM representation
  *
  * PKRM: Pseudo-Kronecker Read-Muller expression---a special case of an ESOP form.
  */
 struct stg_from_pkrm {
+	stg_from_pkrm(stg_from_pkrm_params const& params_ = {})
+	    : params(params_)
+	{}
+
 	/*! \brief Synthesize into a _existing_ quantum network
 	 *
 	 * \param network  A quantum network
@@ -87,7 +100,11 @@ struct stg_from_pkrm {
 		assert(qubits.size() >= static_cast<std::size_t>(num_controls) + 1u);
 
 		std::vector<qubit_id> target = {qubits.back()};
-		for (auto const& cube : easy::esop::esop_from_optimum_pkrm(function)) {
+		const auto esop = params.expansion_cache
+		                      ? easy::esop::esop_from_optimum_pkrm(function,
+		                                                           *params.expansion_cache)
+		                      : easy::esop::esop_from_optimum_pkrm(function);
+		for (auto const& cube : esop) {
 			std::vector<qubit_id> controls;
 			std::vector<qubit_id> negations;
 			auto bits = cube._bits;
@@ -102,6 +119,8 @@ struct stg_from_pkrm {
 			network.add_gate(gate::mcx, controls, target);
 		}
 	}
+
+	stg_from_pkrm_params params;
 };
 
 /*! \brief Synthesize a quantum network from a function by computing PPRM representation
@@ -176,7 +195,7 @@ struct stg_from_spectrum {
 		kitty::create_nth_var(xt, num_controls);
 		gate_function &= xt;
 
-		parity_terms parities;
+		parity_terms<> parities;
 		const float nom = M_PI / (1 << gate_function.num_vars());
 		const auto spectrum = kitty::rademacher_walsh_spectrum(gate_function);
 		for (auto i = 1u; i < spectrum.size(); ++i) {
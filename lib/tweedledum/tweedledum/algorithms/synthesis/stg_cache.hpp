@@ -0,0 +1,272 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "../../gates/gate_base.hpp"
+#include "../../networks/gate_recorder.hpp"
+#include "../../networks/qubit.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+#include <kitty/npn.hpp>
+#include <kitty/operators.hpp>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace tweedledum {
+
+/*! \brief Parameters for `stg_cache`. */
+struct stg_cache_params {
+	/*! \brief How functions are mapped to cache entries. */
+	enum class canonization : uint8_t {
+		/*! \brief Exact NPN canonization for small functions, sifting for larger ones. */
+		exact,
+		/*! \brief Approximate NPN canonization based on sifting. (**default**) */
+		sifting,
+		/*! \brief No canonization, only identical functions share an entry. */
+		none,
+	} canonization = canonization::sifting;
+
+	/*! \brief Maximum number of variables for exact NPN canonization. */
+	uint32_t exact_max_vars = 6u;
+};
+
+/*! \brief Statistics for `stg_cache`. */
+struct stg_cache_stats {
+	/*! \brief Number of calls that reused a cached circuit. */
+	uint64_t hits = 0u;
+
+	/*! \brief Number of calls that required synthesis. */
+	uint64_t misses = 0u;
+};
+
+/*! \brief Memoizing wrapper for single-target gate synthesis functions
+ *
+ * The wrapper canonizes each function w.r.t. NPN equivalence, synthesizes a circuit for the
+ * representative function using ``StgFn`` once, and replays it for every function in the same
+ * class.  Input permutations are applied by mapping qubits, input negations by inverting control
+ * polarities (or by surrounding the circuit with NOT gates, if the input qubit is not only used as
+ * control), and output negation by a NOT gate on the target.
+ *
+ * Copies of a cache share the same storage, and the cache can be used from several threads
+ * concurrently.
+ *
+   \verbatim embed:rst
+
+   .. code-block:: c++
+
+      stg_cache<stg_from_pkrm> cache;
+      logic_network_synthesis(circ, klut, strategy, cache);
+      std::cout << cache.stats().hits << " " << cache.stats().misses << "\n";
+
+   \endverbatim
+ */
+template<class StgFn>
+class stg_cache {
+	struct circuit_entry {
+		gate_recorder circuit;
+		/* true, if input qubits are only used as controls */
+		bool controls_only;
+	};
+
+	struct function_entry {
+		std::shared_ptr<circuit_entry const> circuit;
+		/* variable i of the representative is read from input qubit inputs[i] */
+		std::vector<uint32_t> inputs;
+		/* input negations, output negation is stored as bit n */
+		uint32_t phase;
+	};
+
+	using map_type = std::unordered_map<kitty::dynamic_truth_table, function_entry,
+	                                    kitty::hash<kitty::dynamic_truth_table>>;
+	using class_map_type = std::unordered_map<kitty::dynamic_truth_table,
+	                                          std::shared_ptr<circuit_entry const>,
+	                                          kitty::hash<kitty::dynamic_truth_table>>;
+
+	struct storage {
+		std::mutex mutex;
+		map_type functions;
+		class_map_type classes;
+		stg_cache_stats stats;
+	};
+
+public:
+	stg_cache(StgFn const& stg_fn = {}, stg_cache_params const& params = {})
+	    : stg_fn_(stg_fn)
+	    , params_(params)
+	    , storage_(std::make_shared<storage>())
+	{}
+
+	/*! \brief Synthesize a single target gate into a _existing_ quantum network
+	 *
+	 * \param network  A quantum network
+	 * \param qubits   The subset of qubits the gate acts upon.
+	 * \param function
+	 */
+	template<class Network>
+	void operator()(Network& network, std::vector<qubit_id> const& qubits,
+	                kitty::dynamic_truth_table const& function) const
+	{
+		const auto entry = lookup(function);
+		const auto num_vars = function.num_vars();
+
+		std::vector<qubit_id> mapped(num_vars + 1u);
+		for (auto i = 0u; i < num_vars; ++i) {
+			mapped[i] = qubits[entry.inputs[i]];
+		}
+		mapped[num_vars] = qubits[num_vars];
+
+		auto const& circuit = *entry.circuit;
+		if (circuit.controls_only) {
+			for (auto i = 0u; i < num_vars; ++i) {
+				if ((entry.phase >> entry.inputs[i]) & 1) {
+					mapped[i] = !mapped[i];
+				}
+			}
+			circuit.circuit.replay(network, mapped);
+		} else {
+			for (auto i = 0u; i < num_vars; ++i) {
+				if ((entry.phase >> i) & 1) {
+					network.add_gate(gate::pauli_x, qubits[i]);
+				}
+			}
+			circuit.circuit.replay(network, mapped);
+			for (auto i = 0u; i < num_vars; ++i) {
+				if ((entry.phase >> i) & 1) {
+					network.add_gate(gate::pauli_x, qubits[i]);
+				}
+			}
+		}
+		if ((entry.phase >> num_vars) & 1) {
+			network.add_gate(gate::pauli_x, qubits[num_vars]);
+		}
+	}
+
+	/*! \brief Returns the number of cache hits and misses. */
+	stg_cache_stats stats() const
+	{
+		std::lock_guard<std::mutex> lock(storage_->mutex);
+		return storage_->stats;
+	}
+
+private:
+	function_entry lookup(kitty::dynamic_truth_table const& function) const
+	{
+		{
+			std::lock_guard<std::mutex> lock(storage_->mutex);
+			if (auto it = storage_->functions.find(function); it != storage_->functions.end()) {
+				++storage_->stats.hits;
+				return it->second;
+			}
+		}
+
+		/* canonization and synthesis are done without holding the lock */
+		const auto [repr, phase, perm] = canonize(function);
+		function_entry entry{nullptr, inputs_from_perm(perm), phase};
+
+		std::shared_ptr<circuit_entry const> circuit;
+		{
+			std::lock_guard<std::mutex> lock(storage_->mutex);
+			if (auto it = storage_->classes.find(repr); it != storage_->classes.end()) {
+				circuit = it->second;
+			}
+		}
+
+		const auto synthesized = !circuit;
+		if (synthesized) {
+			circuit = synthesize(repr);
+		}
+
+		std::lock_guard<std::mutex> lock(storage_->mutex);
+		if (synthesized) {
+			++storage_->stats.misses;
+			entry.circuit = storage_->classes.emplace(repr, circuit).first->second;
+		} else {
+			++storage_->stats.hits;
+			entry.circuit = circuit;
+		}
+		storage_->functions.emplace(function, entry);
+		return entry;
+	}
+
+	std::tuple<kitty::dynamic_truth_table, uint32_t, std::vector<uint8_t>>
+	canonize(kitty::dynamic_truth_table const& function) const
+	{
+		const auto num_vars = function.num_vars();
+		switch (params_.canonization) {
+		case stg_cache_params::canonization::exact:
+			if (num_vars <= std::min(params_.exact_max_vars, 6u)) {
+				return kitty::exact_npn_canonization(function);
+			}
+			return kitty::sifting_npn_canonization(function);
+		case stg_cache_params::canonization::sifting:
+			return kitty::sifting_npn_canonization(function);
+		default:
+			break;
+		}
+		std::vector<uint8_t> perm(num_vars);
+		std::iota(perm.begin(), perm.end(), 0u);
+		return std::make_tuple(function, 0u, perm);
+	}
+
+	/* mirrors the swaps in `kitty::create_from_npn_config` on the input qubits */
+	static std::vector<uint32_t> inputs_from_perm(std::vector<uint8_t> perm)
+	{
+		std::vector<std::pair<uint32_t, uint32_t>> swaps;
+		for (auto i = 0u; i < perm.size(); ++i) {
+			if (perm[i] == i) {
+				continue;
+			}
+			auto k = i;
+			while (perm[k] != i) {
+				++k;
+			}
+			swaps.emplace_back(i, k);
+			std::swap(perm[i], perm[k]);
+		}
+
+		std::vector<uint32_t> inputs(perm.size());
+		std::iota(inputs.begin(), inputs.end(), 0u);
+		for (auto it = swaps.rbegin(); it != swaps.rend(); ++it) {
+			std::swap(inputs[it->first], inputs[it->second]);
+		}
+		return inputs;
+	}
+
+	std::shared_ptr<circuit_entry const> synthesize(kitty::dynamic_truth_table const& repr) const
+	{
+		const auto num_vars = repr.num_vars();
+		std::vector<qubit_id> qubits(num_vars + 1u);
+		std::iota(qubits.begin(), qubits.end(), 0u);
+
+		auto entry = std::make_shared<circuit_entry>();
+		entry->circuit = gate_recorder(num_vars + 1u);
+		stg_fn_(entry->circuit, qubits, repr);
+
+		entry->controls_only = !entry->circuit.is_rewired();
+		entry->circuit.foreach_gate([&](auto const& gate, qubit_id const* gate_qubits) {
+			for (auto i = 0u; i < gate.num_targets; ++i) {
+				if (gate_qubits[gate.num_controls + i].index() != num_vars) {
+					entry->controls_only = false;
+				}
+			}
+		});
+		return entry;
+	}
+
+private:
+	StgFn stg_fn_;
+	stg_cache_params params_;
+	std::shared_ptr<storage> storage_;
+};
+
+} // namespace tweedledum
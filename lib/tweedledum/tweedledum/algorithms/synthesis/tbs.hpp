@@ -7,6 +7,8 @@
 
 #include "../../networks/qubit.hpp"
 #include "../../networks/netlist.hpp"
+#include "../../utils/detail/permutation_update.hpp"
+#include "../../utils/parallel_for.hpp"
 
 #include <cmath>
 #include <cstdint>
@@ -15,11 +17,26 @@
 #include <iostream>
 #include <kitty/detail/mscfix.hpp>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <numeric>
 #include <vector>
 
 namespace tweedledum {
 
+namespace detail {
+
+/* default cost function in multi-directional synthesis */
+struct tbs_hamming_cost {
+	uint32_t operator()(std::vector<uint32_t> const& permutation, uint32_t x, uint32_t z) const
+	{
+		// hamming distance from z to x and from x to f(z)
+		return __builtin_popcount(z ^ x) + __builtin_popcount(x ^ permutation[z]);
+	}
+};
+
+} // namespace detail
+
 /*! \brief Parameters for `tbs`. */
 struct tbs_params {
 	using cost_fn_type = std::function<uint32_t(std::vector<uint32_t> const&, uint32_t, uint32_t)>;
@@ -44,10 +61,14 @@ struct tbs_params {
 	 *
 	 * By default the number of reversible gates is used as cost function.
 	 */
-	cost_fn_type cost_fn = [](auto& permutation, auto x, auto z) {
-		// hamming distance from z to x and from x to f(z)
-		return __builtin_popcount(z ^ x) + __builtin_popcount(x ^ permutation[z]);
-	};
+	cost_fn_type cost_fn = detail::tbs_hamming_cost{};
+
+	/*! \brief Number of threads for the candidate search in multi-directional synthesis.
+	 *
+	 * A value of 0 uses all hardware threads.  A custom cost function must be safe to call from
+	 * several threads concurrently if more than one thread is used.
+	 */
+	uint32_t num_threads = 1u;
 
 	/*! \brief Be verbose. */
 	bool verbose = false;
@@ -73,23 +94,57 @@ inline std::vector<qubit_id> to_qubit_vector(IntType bits, std::vector<qubit_id>
 
 inline void update_permutation(std::vector<uint32_t>& permutation, uint32_t controls, uint32_t targets)
 {
-	std::for_each(permutation.begin(), permutation.end(), [&](auto& z) {
-		if ((z & controls) == controls) {
-			z ^= targets;
-		}
-	});
+	get_permutation_update_kernels().update(permutation.data(), permutation.size(), controls,
+	                                        targets);
 }
 
 inline void update_permutation_inv(std::vector<uint32_t>& permutation, uint32_t controls, uint32_t targets)
 {
-	for (auto i = 0u; i < permutation.size(); ++i) {
-		if ((i & controls) != controls) {
-			continue;
-		}
-		if (const auto partner = i ^ targets; partner > i) {
-			std::swap(permutation[i], permutation[partner]);
-		}
-	}
+	get_permutation_update_kernels().update_inv(permutation.data(), permutation.size(), controls,
+	                                            targets);
+}
+
+/* Calls fn(i) for all i that contain ``controls`` and not the highest bit of ``targets``, i.e., for
+ * the smaller element of each pair ``(i, i ^ targets)`` affected by a gate. */
+template<typename Fn>
+inline void foreach_pair(uint32_t size, uint32_t controls, uint32_t targets, Fn&& fn)
+{
+	const uint32_t high = 1u << (31u - __builtin_clz(targets));
+	const uint32_t free = (size - 1u) & ~controls & ~high;
+	uint32_t subset = 0u;
+	do {
+		fn(controls | subset);
+		subset = (subset - free) & free;
+	} while (subset != 0u);
+}
+
+/* Variants that keep the inverse permutation up to date.  They require ``controls`` and
+ * ``targets`` to be disjoint and only visit the affected entries. */
+inline void update_permutation(std::vector<uint32_t>& permutation, std::vector<uint32_t>& inverse,
+                               uint32_t controls, uint32_t targets)
+{
+	assert((controls & targets) == 0u);
+	foreach_pair(permutation.size(), controls, targets, [&](auto z) {
+		const auto a = inverse[z];
+		const auto b = inverse[z ^ targets];
+		permutation[a] = z ^ targets;
+		permutation[b] = z;
+		inverse[z] = b;
+		inverse[z ^ targets] = a;
+	});
+}
+
+inline void update_permutation_inv(std::vector<uint32_t>& permutation,
+                                   std::vector<uint32_t>& inverse, uint32_t controls,
+                                   uint32_t targets)
+{
+	assert((controls & targets) == 0u);
+	foreach_pair(permutation.size(), controls, targets, [&](auto i) {
+		const auto partner = i ^ targets;
+		std::swap(permutation[i], permutation[partner]);
+		inverse[permutation[i]] = i;
+		inverse[permutation[partner]] = partner;
+	});
 }
 
 template<typename Network>
@@ -127,6 +182,11 @@ template<typename Network>
 void tbs_bidirectional(Network& network, std::vector<qubit_id> const& qubits,
                        std::vector<uint32_t>& permutation)
 {
+	std::vector<uint32_t> inverse(permutation.size());
+	for (auto x = 0u; x < permutation.size(); ++x) {
+		inverse[permutation[x]] = x;
+	}
+
 	std::list<std::pair<uint32_t, uint32_t>> gates;
 	auto pos = gates.begin();
 	for (auto x = 0u; x < permutation.size(); ++x) {
@@ -136,30 +196,28 @@ void tbs_bidirectional(Network& network, std::vector<qubit_id> const& qubits,
 		}
 
 		auto y = permutation[x];
-		const uint32_t xs = std::distance(permutation.begin(),
-		                                  std::find(permutation.begin() + x,
-		                                            permutation.end(), x));
+		const uint32_t xs = inverse[x];
 		if (__builtin_popcount(x ^ y) <= __builtin_popcount(x ^ xs)) {
 			/* move 0s to 1s */
 			if (const uint32_t t01 = x & ~y) {
-				detail::update_permutation(permutation, y, t01);
+				detail::update_permutation(permutation, inverse, y, t01);
 				pos = gates.emplace(pos, y, t01);
 			}
 			/* move 1s to 0s */
 			if (const uint32_t t10 = ~x & y) {
-				detail::update_permutation(permutation, x, t10);
+				detail::update_permutation(permutation, inverse, x, t10);
 				pos = gates.emplace(pos, x, t10);
 			}
 		} else {
 			/* move 0s to 1s */
 			if (const uint32_t t01 = ~xs & x) {
-				detail::update_permutation_inv(permutation, xs, t01);
+				detail::update_permutation_inv(permutation, inverse, xs, t01);
 				pos = gates.emplace(pos, xs, t01);
 				pos++;
 			}
 			/* move 1s to 0s */
 			if (const uint32_t t10 = xs & ~x) {
-				detail::update_permutation_inv(permutation, x, t10);
+				detail::update_permutation_inv(permutation, inverse, x, t10);
 				pos = gates.emplace(pos, x, t10);
 				pos++;
 			}
@@ -171,24 +229,51 @@ void tbs_bidirectional(Network& network, std::vector<qubit_id> const& qubits,
 	}
 }
 
-template<typename Network>
+/* the candidate search is only parallelized if at least this many candidates remain */
+constexpr uint32_t tbs_parallel_threshold = 1u << 12;
+constexpr uint32_t tbs_parallel_chunk_size = 1u << 10;
+
+/* finds the row z >= x with the cheapest cost to map to x (the first one in case of ties) */
+template<typename CostFn>
+uint32_t tbs_best_candidate(std::vector<uint32_t> const& permutation, uint32_t x,
+                            CostFn const& cost_fn, thread_pool* pool)
+{
+	const uint32_t size = permutation.size();
+	const uint32_t x_cost = __builtin_popcount(x ^ permutation[x]);
+	const auto search = [&](uint32_t begin, uint32_t end) {
+		auto best = std::make_pair(x_cost, x);
+		for (auto xx = begin; xx < end; ++xx) {
+			if (const auto cost = cost_fn(permutation, x, xx); cost < best.first) {
+				best = {cost, xx};
+			}
+		}
+		return best;
+	};
+
+	if (pool == nullptr || size - x - 1 < tbs_parallel_threshold) {
+		return search(x + 1, size).second;
+	}
+
+	auto best = std::make_pair(x_cost, x);
+	std::mutex best_mutex;
+	pool->parallel_for_chunks(size - x - 1, tbs_parallel_chunk_size, [&](auto begin, auto end) {
+		const auto chunk_best = search(x + 1 + begin, x + 1 + end);
+		std::lock_guard<std::mutex> lock(best_mutex);
+		best = std::min(best, chunk_best);
+	});
+	return best.second;
+}
+
+template<typename Network, typename CostFn>
 void tbs_multidirectional(Network& network, std::vector<qubit_id> const& qubits,
-                          std::vector<uint32_t>& permutation, tbs_params params = {})
+                          std::vector<uint32_t>& permutation, CostFn const& cost_fn,
+                          thread_pool* pool)
 {
 	std::list<std::pair<uint32_t, uint32_t>> gates;
 	auto pos = gates.begin();
 	for (auto x = 0u; x < permutation.size(); ++x) {
 		// find cheapest assignment
-		auto x_best = x;
-		uint32_t x_cost = __builtin_popcount(x ^ permutation[x]);
-		for (auto xx = x + 1; xx < permutation.size(); ++xx) {
-			if (const auto cost = params.cost_fn(permutation, x, xx); cost < x_cost) {
-				x_best = xx;
-				x_cost = cost;
-			}
-		}
-
-		const auto z = x_best;
+		const auto z = tbs_best_candidate(permutation, x, cost_fn, pool);
 		const auto y = permutation[z];
 
 		// map z |-> x
@@ -225,6 +310,23 @@ void tbs_multidirectional(Network& network, std::vector<qubit_id> const& qubits,
 	}
 }
 
+template<typename Network>
+void tbs_multidirectional(Network& network, std::vector<qubit_id> const& qubits,
+                          std::vector<uint32_t>& permutation, tbs_params const& params)
+{
+	std::unique_ptr<thread_pool> pool;
+	if (params.num_threads != 1u && permutation.size() > tbs_parallel_threshold) {
+		pool = std::make_unique<thread_pool>(params.num_threads);
+	}
+
+	// the default cost function is evaluated inline instead of through std::function
+	if (!params.cost_fn || params.cost_fn.target<tbs_hamming_cost>() != nullptr) {
+		tbs_multidirectional(network, qubits, permutation, tbs_hamming_cost{}, pool.get());
+	} else {
+		tbs_multidirectional(network, qubits, permutation, params.cost_fn, pool.get());
+	}
+}
+
 } // namespace detail
 
 /*! \brief Transformation-based reversible logic synthesis.
@@ -0,0 +1,748 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "../gates/gate_base.hpp"
+#include "../networks/qubit.hpp"
+#include "../utils/angle.hpp"
+#include "../utils/detail/mapped_file.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fmt/format.h>
+#include <fstream>
+#include <kitty/dynamic_truth_table.hpp>
+#include <kitty/hash.hpp>
+#include <kitty/operators.hpp>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tweedledum {
+
+namespace detail {
+
+/* Binary circuit files are laid out as
+ *
+ *   header | gate records | qubit labels | angles | functions | rewiring map | trailer
+ *
+ * All values are stored in the byte order of the host (little-endian on all supported
+ * platforms), and all sections start at 8-byte aligned offsets.  Since section sizes are only
+ * known at the end, they are described in the trailer, which makes it possible to write files
+ * in a single pass, even into non-seekable streams. */
+constexpr char binary_magic[8] = {'T', 'W', 'D', 'L', 'C', 'I', 'R', 'C'};
+constexpr uint32_t binary_version = 1u;
+
+/* qubits stored in the first record of a gate and in each continuation record */
+constexpr uint32_t binary_inline_qubits = 5u;
+constexpr uint32_t binary_continuation_qubits = 8u;
+
+/* flags of a gate record */
+constexpr uint8_t binary_has_function = 1u;
+
+struct binary_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+/* Each gate is a fixed-width record, followed by continuation records if the gate acts on more
+ * than `binary_inline_qubits` qubits.  Qubits are stored as literals (index << 1 | complemented),
+ * controls first.  ``side`` is an index into the function table if the gate has a function,
+ * and into the angle table otherwise. */
+struct binary_gate_record {
+	uint8_t operation;
+	uint8_t flags;
+	uint16_t num_controls;
+	uint16_t num_targets;
+	uint16_t num_records;
+	uint32_t side;
+	uint32_t qubits[binary_inline_qubits];
+};
+
+struct binary_angle {
+	uint32_t symbolic;
+	uint32_t reserved;
+	double numerical;
+};
+
+struct binary_trailer {
+	uint64_t num_gates;
+	uint64_t num_records;
+	uint64_t labels_offset;
+	uint64_t angles_offset;
+	uint64_t functions_offset;
+	uint64_t rewiring_offset;
+	uint32_t num_qubits;
+	uint32_t num_angles;
+	uint32_t num_functions;
+	uint32_t reserved;
+	char magic[8];
+};
+
+static_assert(sizeof(binary_header) == 16u);
+static_assert(sizeof(binary_gate_record) == 32u);
+static_assert(sizeof(binary_gate_record) == binary_continuation_qubits * sizeof(uint32_t));
+static_assert(sizeof(binary_angle) == 16u);
+static_assert(sizeof(binary_trailer) == 72u);
+
+inline uint32_t binary_num_records(uint32_t num_qubits)
+{
+	if (num_qubits <= binary_inline_qubits) {
+		return 1u;
+	}
+	return 1u + (num_qubits - binary_inline_qubits + binary_continuation_qubits - 1u)
+	                / binary_continuation_qubits;
+}
+
+template<typename Gate, typename = void>
+struct has_gate_function : std::false_type {};
+
+template<typename Gate>
+struct has_gate_function<Gate, std::void_t<decltype(std::declval<Gate const&>().function())>>
+    : std::true_type {};
+
+} // namespace detail
+
+/*! \brief Streaming writer for binary circuit files
+ *
+ * Gate records are written to the output stream as soon as they are added; only qubit labels,
+ * distinct rotation angles, and distinct gate functions are kept in memory until `finish` is
+ * called.  The stream does not need to be seekable.
+ */
+class binary_writer {
+public:
+	explicit binary_writer(std::ostream& os)
+	    : os_(os)
+	{
+		detail::binary_header header;
+		std::memcpy(header.magic, detail::binary_magic, sizeof(header.magic));
+		header.version = detail::binary_version;
+		header.record_size = sizeof(detail::binary_gate_record);
+		write(&header, sizeof(header));
+	}
+
+	binary_writer(binary_writer const&) = delete;
+	binary_writer& operator=(binary_writer const&) = delete;
+
+#pragma region Qubits
+	qubit_id add_qubit(std::string const& qlabel)
+	{
+		qubit_id qid(static_cast<uint32_t>(label_offsets_.size()));
+		labels_ += qlabel;
+		label_offsets_.push_back(static_cast<uint32_t>(labels_.size()));
+		return qid;
+	}
+
+	qubit_id add_qubit()
+	{
+		return add_qubit(fmt::format("q{}", label_offsets_.size()));
+	}
+
+	uint32_t num_qubits() const
+	{
+		return static_cast<uint32_t>(label_offsets_.size());
+	}
+
+	uint64_t num_gates() const
+	{
+		return num_gates_;
+	}
+
+	/*! \brief Sets the rewiring map that is stored with the circuit (default: identity). */
+	void set_rewiring_map(std::vector<uint32_t> const& rewiring_map)
+	{
+		rewiring_map_ = rewiring_map;
+	}
+#pragma endregion
+
+#pragma region Gates
+	/*! \brief Writes a gate whose controls and targets are given as qubit literals. */
+	void write_gate(gate_base const& op, uint32_t const* controls, uint32_t num_controls,
+	                uint32_t const* targets, uint32_t num_targets,
+	                kitty::dynamic_truth_table const* function = nullptr)
+	{
+		if (num_controls > 0xffffu || num_targets > 0xffffu) {
+			throw std::length_error("gate has too many qubits for binary circuit format");
+		}
+
+		detail::binary_gate_record record;
+		std::memset(&record, 0, sizeof(record));
+		record.operation = static_cast<uint8_t>(op.operation());
+		record.num_controls = static_cast<uint16_t>(num_controls);
+		record.num_targets = static_cast<uint16_t>(num_targets);
+		record.num_records = static_cast<uint16_t>(
+		    detail::binary_num_records(num_controls + num_targets));
+		if (function != nullptr) {
+			record.flags |= detail::binary_has_function;
+			record.side = function_index(*function);
+		} else {
+			record.side = angle_index(op.rotation_angle());
+		}
+
+		/* first record and continuation records are filled from the same stream of literals */
+		auto* slot = record.qubits;
+		auto* end = record.qubits + detail::binary_inline_qubits;
+		auto push = [&](uint32_t literal) {
+			if (slot == end) {
+				write(&record, sizeof(record));
+				++num_records_;
+				std::memset(&record, 0, sizeof(record));
+				slot = reinterpret_cast<uint32_t*>(&record);
+				end = slot + detail::binary_continuation_qubits;
+			}
+			*slot++ = literal;
+		};
+		for (auto i = 0u; i < num_controls; ++i) {
+			push(controls[i]);
+		}
+		for (auto i = 0u; i < num_targets; ++i) {
+			push(targets[i]);
+		}
+		write(&record, sizeof(record));
+		++num_records_;
+		++num_gates_;
+	}
+
+	/*! \brief Writes a gate of a network. */
+	template<class Gate>
+	void write_gate(Gate const& gate)
+	{
+		literals_.clear();
+		gate.foreach_control([&](auto qid) { literals_.push_back(qid.literal()); });
+		const auto num_controls = static_cast<uint32_t>(literals_.size());
+		gate.foreach_target([&](auto qid) { literals_.push_back(qid.literal()); });
+
+		kitty::dynamic_truth_table const* function = nullptr;
+		if constexpr (detail::has_gate_function<Gate>::value) {
+			if (gate.has_function()) {
+				function = &gate.function();
+			}
+		}
+		write_gate(gate, literals_.data(), num_controls, literals_.data() + num_controls,
+		           static_cast<uint32_t>(literals_.size()) - num_controls, function);
+	}
+#pragma endregion
+
+	/*! \brief Writes the side tables and the trailer, no gates can be added afterwards. */
+	void finish()
+	{
+		detail::binary_trailer trailer;
+		std::memset(&trailer, 0, sizeof(trailer));
+		trailer.num_gates = num_gates_;
+		trailer.num_records = num_records_;
+		trailer.num_qubits = num_qubits();
+		trailer.num_angles = static_cast<uint32_t>(angles_.size());
+		trailer.num_functions = static_cast<uint32_t>(functions_.size());
+		std::memcpy(trailer.magic, detail::binary_magic, sizeof(trailer.magic));
+
+		/* labels: offsets to the end of each label, followed by the characters */
+		trailer.labels_offset = offset_;
+		write(label_offsets_.data(), label_offsets_.size() * sizeof(uint32_t));
+		write(labels_.data(), labels_.size());
+		pad();
+
+		trailer.angles_offset = offset_;
+		write(angles_.data(), angles_.size() * sizeof(detail::binary_angle));
+
+		/* functions: absolute offsets of all entries, followed by (num_vars, num_words, words) */
+		trailer.functions_offset = offset_;
+		std::vector<uint64_t> function_offsets;
+		auto entry_offset = offset_ + functions_.size() * sizeof(uint64_t);
+		for (auto const& function : functions_) {
+			function_offsets.push_back(entry_offset);
+			entry_offset += 2 * sizeof(uint32_t) + function.num_blocks() * sizeof(uint64_t);
+		}
+		write(function_offsets.data(), function_offsets.size() * sizeof(uint64_t));
+		for (auto const& function : functions_) {
+			const uint32_t sizes[2] = {static_cast<uint32_t>(function.num_vars()),
+			                           static_cast<uint32_t>(function.num_blocks())};
+			write(sizes, sizeof(sizes));
+			write(&*function.cbegin(), function.num_blocks() * sizeof(uint64_t));
+		}
+
+		trailer.rewiring_offset = offset_;
+		auto rewiring_map = rewiring_map_;
+		for (auto i = static_cast<uint32_t>(rewiring_map.size()); i < num_qubits(); ++i) {
+			rewiring_map.push_back(i);
+		}
+		rewiring_map.resize(num_qubits());
+		write(rewiring_map.data(), rewiring_map.size() * sizeof(uint32_t));
+		pad();
+
+		write(&trailer, sizeof(trailer));
+		os_.flush();
+		if (!os_) {
+			throw std::runtime_error("cannot write binary circuit");
+		}
+	}
+
+private:
+	void write(void const* data, std::size_t size)
+	{
+		os_.write(static_cast<char const*>(data), size);
+		offset_ += size;
+	}
+
+	void pad()
+	{
+		static constexpr char zeros[8] = {};
+		write(zeros, (8u - offset_ % 8u) % 8u);
+	}
+
+	uint32_t angle_index(angle const& value)
+	{
+		detail::binary_angle entry{static_cast<uint32_t>(value.symbolic_value()), 0u,
+		                           value.is_symbolic_defined() ? 0.0 : value.numeric_value()};
+		std::string key(reinterpret_cast<char const*>(&entry), sizeof(entry));
+		const auto [it, inserted] = angle_indexes_.emplace(key, angles_.size());
+		if (inserted) {
+			angles_.push_back(entry);
+		}
+		return it->second;
+	}
+
+	uint32_t function_index(kitty::dynamic_truth_table const& function)
+	{
+		const auto [it, inserted] = function_indexes_.emplace(function, functions_.size());
+		if (inserted) {
+			functions_.push_back(function);
+		}
+		return it->second;
+	}
+
+private:
+	std::ostream& os_;
+	uint64_t offset_ = 0u;
+	uint64_t num_gates_ = 0u;
+	uint64_t num_records_ = 0u;
+	std::vector<uint32_t> literals_;
+
+	std::vector<uint32_t> label_offsets_;
+	std::string labels_;
+	std::vector<uint32_t> rewiring_map_;
+	std::vector<detail::binary_angle> angles_;
+	std::unordered_map<std::string, uint32_t> angle_indexes_;
+	std::vector<kitty::dynamic_truth_table> functions_;
+	std::unordered_map<kitty::dynamic_truth_table, uint32_t,
+	                   kitty::hash<kitty::dynamic_truth_table>>
+	    function_indexes_;
+};
+
+class binary_reader;
+
+/*! \brief View of a gate record in a binary circuit file */
+class binary_gate : public gate_base {
+public:
+	uint32_t num_controls() const
+	{
+		return record_->num_controls;
+	}
+
+	uint32_t num_targets() const
+	{
+		return record_->num_targets;
+	}
+
+	bool has_function() const
+	{
+		return (record_->flags & detail::binary_has_function) != 0u;
+	}
+
+	/*! \brief Returns the gate function (the truth table is copied out of the file). */
+	kitty::dynamic_truth_table function() const;
+
+	template<typename Fn>
+	void foreach_control(Fn&& fn) const
+	{
+		for (auto i = 0u; i < record_->num_controls; ++i) {
+			fn(qubit(i));
+		}
+	}
+
+	template<typename Fn>
+	void foreach_target(Fn&& fn) const
+	{
+		for (auto i = 0u; i < record_->num_targets; ++i) {
+			fn(qubit(record_->num_controls + i));
+		}
+	}
+
+private:
+	friend class binary_reader;
+
+	binary_gate(gate_base const& op, detail::binary_gate_record const* record,
+	            binary_reader const* reader)
+	    : gate_base(op)
+	    , record_(record)
+	    , reader_(reader)
+	{}
+
+	qubit_id qubit(uint32_t i) const
+	{
+		uint32_t literal;
+		if (i < detail::binary_inline_qubits) {
+			literal = record_->qubits[i];
+		} else {
+			i -= detail::binary_inline_qubits;
+			literal = reinterpret_cast<uint32_t const*>(
+			    record_ + 1 + i / detail::binary_continuation_qubits)
+			    [i % detail::binary_continuation_qubits];
+		}
+		return qubit_id(literal >> 1, (literal & 1) == 1);
+	}
+
+private:
+	detail::binary_gate_record const* record_;
+	binary_reader const* reader_;
+};
+
+/*! \brief Zero-copy reader for binary circuit files
+ *
+ * The file is memory mapped and gates are decoded lazily while iterating over them.  The reader
+ * validates the header, the trailer, and the side tables when it is constructed and throws
+ * `std::runtime_error` for malformed files.
+ */
+class binary_reader {
+public:
+	explicit binary_reader(std::string const& filename)
+	    : file_(std::make_shared<detail::mapped_file>(filename))
+	    , data_(file_->data())
+	    , size_(file_->size())
+	{
+		validate();
+	}
+
+	/*! \brief Reads from an 8-byte aligned buffer, which must outlive the reader. */
+	binary_reader(void const* data, std::size_t size)
+	    : data_(static_cast<char const*>(data))
+	    , size_(size)
+	{
+		validate();
+	}
+
+	uint32_t num_qubits() const
+	{
+		return trailer_.num_qubits;
+	}
+
+	uint64_t num_gates() const
+	{
+		return trailer_.num_gates;
+	}
+
+	std::string_view qubit_label(uint32_t index) const
+	{
+		const auto* offsets = at<uint32_t>(trailer_.labels_offset);
+		const auto* chars = reinterpret_cast<char const*>(offsets + trailer_.num_qubits);
+		const auto begin = index == 0u ? 0u : offsets[index - 1];
+		return std::string_view(chars + begin, offsets[index] - begin);
+	}
+
+	std::vector<uint32_t> rewiring_map() const
+	{
+		const auto* map = at<uint32_t>(trailer_.rewiring_offset);
+		return std::vector<uint32_t>(map, map + trailer_.num_qubits);
+	}
+
+	/*! \brief Calls ``fn(gate)`` for each gate, where ``gate`` is a `binary_gate`.
+	 *
+	 * Gate records are checked while iterating, so that a malformed record is only detected (and
+	 * reported with `std::runtime_error`) when it is reached.
+	 */
+	template<typename Fn>
+	void foreach_gate(Fn&& fn) const
+	{
+		const auto* record = at<detail::binary_gate_record>(sizeof(detail::binary_header));
+		const auto* end = record + trailer_.num_records;
+		uint64_t num_gates = 0u;
+		while (record < end) {
+			validate(record, end);
+			fn(binary_gate(gate_base(static_cast<gate_set>(record->operation),
+			                         gate_angle(*record)),
+			               record, this));
+			record += record->num_records;
+			++num_gates;
+		}
+		if (num_gates != trailer_.num_gates) {
+			fail("wrong number of gates");
+		}
+	}
+
+	kitty::dynamic_truth_table function(uint32_t index) const
+	{
+		const auto offset = at<uint64_t>(trailer_.functions_offset)[index];
+		const auto* sizes = at<uint32_t>(offset);
+		const auto* words = at<uint64_t>(offset + 2 * sizeof(uint32_t));
+		kitty::dynamic_truth_table function(sizes[0]);
+		std::copy(words, words + sizes[1], function.begin());
+		return function;
+	}
+
+private:
+	template<typename T>
+	T const* at(uint64_t offset) const
+	{
+		return reinterpret_cast<T const*>(data_ + offset);
+	}
+
+	angle gate_angle(detail::binary_gate_record const& record) const
+	{
+		if (record.flags & detail::binary_has_function) {
+			return angle(0.0);
+		}
+		auto const& entry = at<detail::binary_angle>(trailer_.angles_offset)[record.side];
+		if (entry.symbolic != static_cast<uint32_t>(symbolic_angles::numerically_defined)) {
+			return angle(static_cast<symbolic_angles>(entry.symbolic));
+		}
+		return angle(entry.numerical);
+	}
+
+	void validate()
+	{
+		if (size_ < sizeof(detail::binary_header) + sizeof(detail::binary_trailer)) {
+			fail("file too small");
+		}
+		detail::binary_header header;
+		std::memcpy(&header, data_, sizeof(header));
+		if (std::memcmp(header.magic, detail::binary_magic, sizeof(header.magic)) != 0) {
+			fail("bad magic number");
+		}
+		if (header.version != detail::binary_version) {
+			fail("unsupported version");
+		}
+		if (header.record_size != sizeof(detail::binary_gate_record)) {
+			fail("unsupported record size");
+		}
+		std::memcpy(&trailer_, data_ + size_ - sizeof(trailer_), sizeof(trailer_));
+		if (std::memcmp(trailer_.magic, detail::binary_magic, sizeof(trailer_.magic)) != 0) {
+			fail("truncated file");
+		}
+
+		/* all sections must be ordered and inside the file */
+		const uint64_t trailer_offset = size_ - sizeof(trailer_);
+		if (!fits(sizeof(detail::binary_header), trailer_.num_records,
+		          sizeof(detail::binary_gate_record), trailer_.labels_offset)
+		    || !fits(trailer_.labels_offset, trailer_.num_qubits, sizeof(uint32_t),
+		             trailer_.angles_offset)
+		    || !fits(trailer_.angles_offset, trailer_.num_angles, sizeof(detail::binary_angle),
+		             trailer_.functions_offset)
+		    || !fits(trailer_.functions_offset, trailer_.num_functions, sizeof(uint64_t),
+		             trailer_.rewiring_offset)
+		    || !fits(trailer_.rewiring_offset, trailer_.num_qubits, sizeof(uint32_t),
+		             trailer_offset)) {
+			fail("section out of bounds");
+		}
+		if (trailer_.labels_offset % 8u || trailer_.angles_offset % 8u
+		    || trailer_.functions_offset % 8u || trailer_.rewiring_offset % 8u) {
+			fail("misaligned section");
+		}
+
+		const auto* offsets = at<uint32_t>(trailer_.labels_offset);
+		const auto labels_size = trailer_.angles_offset - trailer_.labels_offset
+		                         - trailer_.num_qubits * sizeof(uint32_t);
+		for (auto i = 0u; i < trailer_.num_qubits; ++i) {
+			if (offsets[i] > labels_size || (i > 0u && offsets[i] < offsets[i - 1])) {
+				fail("bad qubit label");
+			}
+		}
+
+		const auto* angles = at<detail::binary_angle>(trailer_.angles_offset);
+		for (auto i = 0u; i < trailer_.num_angles; ++i) {
+			if (angles[i].symbolic > static_cast<uint32_t>(symbolic_angles::numerically_defined)) {
+				fail("bad angle");
+			}
+		}
+
+		const auto* rewiring_map = at<uint32_t>(trailer_.rewiring_offset);
+		for (auto i = 0u; i < trailer_.num_qubits; ++i) {
+			if (rewiring_map[i] >= trailer_.num_qubits) {
+				fail("bad rewiring map");
+			}
+		}
+
+		const auto* function_offsets = at<uint64_t>(trailer_.functions_offset);
+		for (auto i = 0u; i < trailer_.num_functions; ++i) {
+			const auto offset = function_offsets[i];
+			if (offset % 8u || !fits(offset, 2u, sizeof(uint32_t), trailer_.rewiring_offset)) {
+				fail("bad function");
+			}
+			const auto* sizes = at<uint32_t>(offset);
+			if (sizes[0] > 32u || sizes[1] != (sizes[0] <= 6u ? 1u : 1u << (sizes[0] - 6u))
+			    || !fits(offset + 2 * sizeof(uint32_t), sizes[1], sizeof(uint64_t),
+			             trailer_.rewiring_offset)) {
+				fail("bad function");
+			}
+		}
+
+	}
+
+	void validate(detail::binary_gate_record const* record,
+	              detail::binary_gate_record const* end) const
+	{
+		const auto num_qubits = uint32_t(record->num_controls) + record->num_targets;
+		if (record->num_records != detail::binary_num_records(num_qubits)
+		    || record->num_records > end - record) {
+			fail("bad gate record");
+		}
+		/* gates with a function have no operation of the gate set, all other gates must have a
+		 * unitary operation (no meta operation) */
+		const auto has_function = (record->flags & detail::binary_has_function) != 0;
+		if (has_function
+		        ? record->operation != static_cast<uint8_t>(gate_set::num_defined_ops)
+		        : (record->operation < static_cast<uint8_t>(gate_set::identity)
+		           || record->operation >= static_cast<uint8_t>(gate_set::num_defined_ops))) {
+			fail("bad gate record");
+		}
+		if (has_function) {
+			if (record->side >= trailer_.num_functions || record->num_targets != 1u) {
+				fail("bad gate record");
+			}
+		} else if (record->side >= trailer_.num_angles) {
+			fail("bad gate record");
+		}
+		for (auto i = 0u; i < num_qubits; ++i) {
+			const auto literal = i < detail::binary_inline_qubits
+			                         ? record->qubits[i]
+			                         : reinterpret_cast<uint32_t const*>(record + 1)
+			                               [i - detail::binary_inline_qubits];
+			if ((literal >> 1) >= trailer_.num_qubits) {
+				fail("qubit out of range");
+			}
+		}
+	}
+
+	/* checks whether `count` elements of `size` bytes starting at `offset` end before `limit`,
+	 * without overflowing in the computation of the end */
+	static bool fits(uint64_t offset, uint64_t count, uint64_t size, uint64_t limit)
+	{
+		return offset <= limit && count <= (limit - offset) / size;
+	}
+
+	[[noreturn]] static void fail(char const* reason)
+	{
+		throw std::runtime_error(fmt::format("invalid binary circuit: {}", reason));
+	}
+
+private:
+	std::shared_ptr<detail::mapped_file> file_;
+	char const* data_;
+	std::size_t size_;
+	detail::binary_trailer trailer_;
+};
+
+inline kitty::dynamic_truth_table binary_gate::function() const
+{
+	return reader_->function(record_->side);
+}
+
+/*! \brief Writes network in binary format into output stream
+ *
+ * An overloaded variant exists that writes the network into a file.
+ *
+ * **Required gate functions:**
+ * - `foreach_control`
+ * - `foreach_target`
+ * - `operation`
+ * - `rotation_angle`
+ *
+ * **Required network functions:**
+ * - `foreach_cgate`
+ * - `foreach_cqubit`
+ * - `rewire_map`
+ *
+ * \param network A quantum network
+ * \param os Output stream
+ */
+template<typename Network>
+void write_binary(Network const& network, std::ostream& os)
+{
+	binary_writer writer(os);
+	network.foreach_cqubit([&](qubit_id, std::string const& qlabel) { writer.add_qubit(qlabel); });
+	network.foreach_cgate([&](auto const& node) { writer.write_gate(node.gate); });
+	writer.set_rewiring_map(network.rewire_map());
+	writer.finish();
+}
+
+/*! \brief Writes network in binary format into a file
+ *
+ * \param network A quantum network
+ * \param filename Filename
+ */
+template<typename Network>
+void write_binary(Network const& network, std::string const& filename)
+{
+	std::ofstream os(filename, std::ofstream::out | std::ofstream::binary);
+	if (!os) {
+		throw std::runtime_error(fmt::format("cannot open file '{}'", filename));
+	}
+	write_binary(network, os);
+}
+
+/*! \brief Reads a binary circuit into an empty network
+ *
+ * Gates are added on the qubits stored in the file, and the rewiring map of the network is set
+ * after all gates have been added.
+ *
+ * \param network An empty quantum network
+ * \param reader A binary circuit reader
+ */
+template<typename Network>
+void read_binary(Network& network, binary_reader const& reader)
+{
+	using gate_type = typename Network::gate_type;
+
+	for (auto i = 0u; i < reader.num_qubits(); ++i) {
+		network.add_qubit(std::string(reader.qubit_label(i)));
+	}
+
+	std::vector<qubit_id> controls, targets;
+	reader.foreach_gate([&](binary_gate const& gate) {
+		controls.clear();
+		targets.clear();
+		gate.foreach_control([&](auto qid) { controls.push_back(qid); });
+		gate.foreach_target([&](auto qid) { targets.push_back(qid); });
+
+		if (gate.has_function()) {
+			if constexpr (std::is_constructible_v<gate_type, kitty::dynamic_truth_table,
+			                                      std::vector<qubit_id>, qubit_id>) {
+				network.emplace_gate(gate_type(gate.function(), controls, targets.at(0)));
+				return;
+			} else {
+				throw std::runtime_error("network does not support gates with functions");
+			}
+		}
+		const gate_base op(gate.operation(), gate.rotation_angle());
+		if (controls.empty() && targets.size() == 1u && op.is_single_qubit()) {
+			network.emplace_gate(gate_type(op, targets[0]));
+		} else if (controls.size() == 1u && targets.size() == 1u && op.is_double_qubit()) {
+			network.emplace_gate(gate_type(op, controls[0], targets[0]));
+		} else {
+			network.emplace_gate(gate_type(op, controls, targets));
+		}
+	});
+	network.rewire(reader.rewiring_map());
+}
+
+/*! \brief Reads a binary circuit file into an empty network
+ *
+ * \param network An empty quantum network
+ * \param filename Filename
+ */
+template<typename Network>
+void read_binary(Network& network, std::string const& filename)
+{
+	read_binary(network, binary_reader(filename));
+}
+
+} // namespace tweedledum
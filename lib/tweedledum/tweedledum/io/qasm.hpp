@@ -5,17 +5,207 @@
 *-------------------------------------------------------------------------------------------------*/
 #pragma once
 
+#include "../gates/gate_base.hpp"
 #include "../gates/gate_set.hpp"
 #include "../networks/qubit.hpp"
+#include "../utils/detail/mapped_file.hpp"
+#include "../utils/detail/output_buffer.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <fmt/format.h>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace tweedledum {
 
+namespace detail {
+
+/* reference to a qubit in OPENQASM code, which is either the qubit with the given index in
+ * register ``q``, or the only qubit of register ``q<index>`` */
+struct qasm_qubit {
+	uint32_t index;
+	bool is_register;
+};
+
+} // namespace detail
+} // namespace tweedledum
+
+namespace fmt {
+
+template<>
+struct formatter<tweedledum::detail::qasm_qubit> {
+	template<typename ParseContext>
+	constexpr auto parse(ParseContext& ctx)
+	{
+		return ctx.begin();
+	}
+
+	template<typename FormatContext>
+	auto format(tweedledum::detail::qasm_qubit const& qubit, FormatContext& ctx)
+	{
+		return qubit.is_register ? format_to(ctx.out(), "q{}[0]", qubit.index) :
+		                           format_to(ctx.out(), "q[{}]", qubit.index);
+	}
+};
+
+} // namespace fmt
+
+namespace tweedledum {
+namespace detail {
+
+/* writes the OPENQASM statements of a single gate into a buffer, if `qubit_registers` is true
+ * every qubit is referenced as its own register */
+template<typename Gate>
+void write_qasm_gate(Gate const& gate, fmt::memory_buffer& buffer, bool qubit_registers = false)
+{
+	const auto q = [&](uint32_t index) { return qasm_qubit{index, qubit_registers}; };
+
+	switch (gate.operation()) {
+	default:
+		std::cerr << "[w] unsupported gate type\n";
+		assert(0);
+		return;
+
+	case gate_set::hadamard:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "h {};\n", q(target)); });
+		break;
+
+	case gate_set::pauli_x:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "x {};\n", q(target)); });
+		break;
+
+	case gate_set::pauli_z:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "z {};\n", q(target)); });
+		break;
+
+	case gate_set::phase:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "s {};\n", q(target)); });
+		break;
+
+	case gate_set::phase_dagger:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "sdg {};\n", q(target)); });
+		break;
+
+	case gate_set::t:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "t {};\n", q(target)); });
+		break;
+
+	case gate_set::t_dagger:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "tdg {};\n", q(target)); });
+		break;
+
+	case gate_set::rotation_z:
+		gate.foreach_target([&](auto target) {
+			fmt::format_to(buffer, "rz({}) {};\n", gate.rotation_angle().numeric_value(), q(target));
+		});
+		break;
+	case gate_set::rotation_y:
+		gate.foreach_target([&](auto target) {
+			fmt::format_to(buffer, "ry({}) {};\n", gate.rotation_angle().numeric_value(), q(target));
+		});
+		break;
+	case gate_set::rotation_x:
+		gate.foreach_target([&](auto target) {
+			fmt::format_to(buffer, "rx({}) {};\n", gate.rotation_angle().numeric_value(), q(target));
+		});
+		break;
+
+	case gate_set::cx:
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "x {};\n", q(control.index()));
+			}
+			gate.foreach_target([&](auto target) {
+				fmt::format_to(buffer, "cx {}, {};\n", q(control.index()), q(target));
+			});
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "x {};\n", q(control.index()));
+			}
+		});
+		break;
+
+	case gate_set::swap: {
+		std::vector<qubit_id> targets;
+		gate.foreach_target([&](auto target) {
+			targets.push_back(target);
+		});
+		fmt::format_to(buffer, "cx {}, {};\n", q(targets[0]), q(targets[1]));
+		fmt::format_to(buffer, "cx {}, {};\n", q(targets[1]), q(targets[0]));
+		fmt::format_to(buffer, "cx {}, {};\n", q(targets[0]), q(targets[1]));
+	} break;
+
+	case gate_set::mcx: {
+		std::vector<qubit_id> controls;
+		std::vector<qubit_id> targets;
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "x {};\n", q(control.index()));
+			}
+			controls.push_back(control.index()); 
+		});
+		gate.foreach_target([&](auto target) {
+			targets.push_back(target);
+		});
+		switch (controls.size()) {
+		default:
+			std::cerr << "[w] unsupported control size\n";
+			assert(0);
+			return;
+
+		case 0u:
+			for (auto t : targets) {
+				fmt::format_to(buffer, "x {};\n", q(t));
+			}
+			break;
+
+		case 1u:
+			for (auto t : targets) {
+				fmt::format_to(buffer, "cx {},{};\n", q(controls[0]), q(t));
+			}
+			break;
+
+		case 2u:
+			for (auto i = 1u; i < targets.size(); ++i) {
+				fmt::format_to(buffer, "cx {}, {};\n", q(targets[0]), q(targets[i]));
+			}
+			fmt::format_to(buffer, "ccx {}, {}, {};\n", q(controls[0]), q(controls[1]),
+			               q(targets[0]));
+			for (auto i = 1u; i < targets.size(); ++i) {
+				fmt::format_to(buffer, "cx {}, {};\n", q(targets[0]), q(targets[i]));
+			}
+			break;
+		}
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "x {};\n", q(control.index()));
+			}
+		});
+	} break;
+	}
+}
+
+/* writes the header of a program in which all qubits are in register ``q`` */
+inline void write_qasm_header(uint32_t num_qubits, fmt::memory_buffer& buffer)
+{
+	fmt::format_to(buffer, "OPENQASM 2.0;\n");
+	fmt::format_to(buffer, "include \"qelib1.inc\";\n");
+	fmt::format_to(buffer, "qreg q[{}];\n", num_qubits);
+	fmt::format_to(buffer, "creg c[{}];\n", num_qubits);
+}
+
+} // namespace detail
+
 /*! \brief Writes network in OPENQASM 2.0 format into output stream
  *
  * An overloaded variant exists that writes the network into a file.
@@ -35,161 +225,727 @@ namespace tweedledum {
 template<typename Network>
 void write_qasm(Network const& network, std::ostream& os)
 {
-	// header
-	os << "OPENQASM 2.0;\n";
-	os << "include \"qelib1.inc\";\n";
-	os << fmt::format("qreg q[{}];\n", network.num_qubits());
-	os << fmt::format("creg c[{}];\n", network.num_qubits());
-
+	fmt::memory_buffer buffer;
+	detail::write_qasm_header(network.num_qubits(), buffer);
 	network.foreach_cgate([&](auto const& node) {
-		auto const& gate = node.gate;
-		switch (gate.operation()) {
-		default:
-			std::cerr << "[w] unsupported gate type\n";
-			assert(0);
-			return true;
+		detail::write_qasm_gate(node.gate, buffer);
+		detail::flush_buffer(buffer, os, detail::output_chunk_size);
+		return true;
+	});
+	detail::flush_buffer(buffer, os);
+}
 
-		case gate_set::hadamard:
-			gate.foreach_target([&](auto target) { os << fmt::format("h q[{}];\n", target); });
-			break;
+/*! \brief Writes network in OPENQASM 2.0 format into a file
+ *
+ * **Required gate functions:**
+ * - `foreach_control`
+ * - `foreach_target`
+ * - `op`
+ * 
+ * **Required network functions:**
+ * - `num_qubits`
+ * - `foreach_cnode`
+ *
+ * \param network A quantum network
+ * \param filename Filename
+ */
+template<typename Network>
+void write_qasm(Network const& network, std::string const& filename)
+{
+	std::ofstream os(filename.c_str(), std::ofstream::out);
+	if (!os) {
+		throw std::runtime_error(fmt::format("cannot open file '{}'", filename));
+	}
+	write_qasm(network, os);
+}
 
-		case gate_set::pauli_x:
-			gate.foreach_target([&](auto target) { os << fmt::format("x q[{}];\n", target); });
-			break;
+/*! \brief Writes gates in OPENQASM 2.0 format one at a time
+ *
+ * This writer can be used with a `gate_sink` to write circuits that are too large to be stored.
+ * Since the number of qubits is not known before the first gate is written, every qubit is
+ * declared as a register of its own (``qreg q0[1];``, ``qreg q1[1];``, etc.) when it is added.
+ *
+ * \param os Output stream
+ */
+class qasm_stream_writer {
+public:
+	explicit qasm_stream_writer(std::ostream& os)
+	    : os_(os)
+	{
+		fmt::format_to(buffer_, "OPENQASM 2.0;\n");
+		fmt::format_to(buffer_, "include \"qelib1.inc\";\n");
+	}
 
-		case gate_set::pauli_z:
-			gate.foreach_target([&](auto target) { os << fmt::format("z q[{}];\n", target); });
-			break;
+	qubit_id add_qubit(std::string const&)
+	{
+		fmt::format_to(buffer_, "qreg q{}[1];\n", num_qubits_);
+		return qubit_id(num_qubits_++);
+	}
 
-		case gate_set::phase:
-			gate.foreach_target([&](auto target) { os << fmt::format("s q[{}];\n", target); });
-			break;
+	template<class Gate>
+	void write_gate(Gate const& gate)
+	{
+		detail::write_qasm_gate(gate, buffer_, true);
+		detail::flush_buffer(buffer_, os_, detail::output_chunk_size);
+	}
 
-		case gate_set::phase_dagger:
-			gate.foreach_target([&](auto target) { os << fmt::format("sdg q[{}];\n", target); });
-			break;
+	void finish()
+	{
+		detail::flush_buffer(buffer_, os_);
+		os_.flush();
+	}
 
-		case gate_set::t:
-			gate.foreach_target([&](auto target) { os << fmt::format("t q[{}];\n", target); });
-			break;
+private:
+	std::ostream& os_;
+	fmt::memory_buffer buffer_;
+	uint32_t num_qubits_ = 0u;
+};
 
-		case gate_set::t_dagger:
-			gate.foreach_target([&](auto target) { os << fmt::format("tdg q[{}];\n", target); });
-			break;
+#pragma region Reader
+namespace detail {
 
-		case gate_set::rotation_z:
-			gate.foreach_target([&](auto target) {
-				os << fmt::format("rz({}) q[{}];\n", gate.rotation_angle().numeric_value(), target);
-			});
-			break;
-		case gate_set::rotation_y:
-			gate.foreach_target([&](auto target) {
-				os << fmt::format("ry({}) q[{}];\n", gate.rotation_angle().numeric_value(), target);
-			});
-			break;
-		case gate_set::rotation_x:
-			gate.foreach_target([&](auto target) {
-				os << fmt::format("rx({}) q[{}];\n", gate.rotation_angle().numeric_value(), target);
-			});
-			break;
+/* Reads lexemes directly from a buffer, skipping whitespace and comments */
+class qasm_scanner {
+public:
+	qasm_scanner(char const* begin, char const* end)
+	    : current_(begin)
+	    , end_(end)
+	{}
 
-		case gate_set::cx:
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("x q[{}];\n", control.index());
-				}
-				gate.foreach_target([&](auto target) {
-					os << fmt::format("cx q[{}], q[{}];\n", control.index(), target);
-				});
-				if (control.is_complemented()) {
-					os << fmt::format("x q[{}];\n", control.index());
-				}
-			});
-			break;
+	/*! \brief Returns the next character without consuming it, or '\0' at the end. */
+	char peek()
+	{
+		skip_space();
+		return current_ == end_ ? '\0' : *current_;
+	}
 
-		case gate_set::swap: {
-			std::vector<qubit_id> targets;
-			gate.foreach_target([&](auto target) {
-				targets.push_back(target);
-			});
-			os << fmt::format("cx q[{}], q[{}];\n", targets[0], targets[1]);
-			os << fmt::format("cx q[{}], q[{}];\n", targets[1], targets[0]);
-			os << fmt::format("cx q[{}], q[{}];\n", targets[0], targets[1]);
-		} break;
-
-		case gate_set::mcx: {
-			std::vector<qubit_id> controls;
-			std::vector<qubit_id> targets;
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("x q[{}];\n", control.index());
-				}
-				controls.push_back(control.index()); 
-			});
-			gate.foreach_target([&](auto target) {
-				targets.push_back(target);
-			});
-			switch (controls.size()) {
-			default:
-				std::cerr << "[w] unsupported control size\n";
-				assert(0);
-				return true;
-
-			case 0u:
-				for (auto q : targets) {
-					os << fmt::format("x q[{}];\n", q);
+	bool at_end()
+	{
+		return peek() == '\0' && current_ == end_;
+	}
+
+	bool accept(char symbol)
+	{
+		if (peek() != symbol) {
+			return false;
+		}
+		++current_;
+		return true;
+	}
+
+	bool accept(std::string_view symbol)
+	{
+		skip_space();
+		if (static_cast<std::size_t>(end_ - current_) < symbol.size()
+		    || std::string_view(current_, symbol.size()) != symbol) {
+			return false;
+		}
+		current_ += symbol.size();
+		return true;
+	}
+
+	/*! \brief Returns the next identifier, or an empty view if there is none. */
+	std::string_view identifier()
+	{
+		skip_space();
+		const auto* begin = current_;
+		if (current_ != end_ && is_alpha(*current_)) {
+			do {
+				++current_;
+			} while (current_ != end_ && (is_alpha(*current_) || is_digit(*current_)));
+		}
+		return view(begin);
+	}
+
+	/*! \brief Returns the next number literal, or an empty view if there is none. */
+	std::string_view number()
+	{
+		skip_space();
+		const auto* begin = current_;
+		while (current_ != end_ && (is_digit(*current_) || *current_ == '.')) {
+			++current_;
+		}
+		if (current_ != begin && current_ != end_ && (*current_ == 'e' || *current_ == 'E')) {
+			++current_;
+			if (current_ != end_ && (*current_ == '+' || *current_ == '-')) {
+				++current_;
+			}
+			while (current_ != end_ && is_digit(*current_)) {
+				++current_;
+			}
+		}
+		return view(begin);
+	}
+
+	/*! \brief Returns the contents of the next string literal. */
+	std::string_view string()
+	{
+		if (!accept('"')) {
+			return std::string_view();
+		}
+		const auto* begin = current_;
+		current_ = std::find(current_, end_, '"');
+		if (current_ == end_) {
+			throw std::runtime_error(fmt::format("qasm:{}: unterminated string", line_));
+		}
+		return std::string_view(begin, current_++ - begin);
+	}
+
+	/*! \brief Returns the next lexeme without consuming it (used in error messages). */
+	std::string_view lexeme()
+	{
+		skip_space();
+		const auto* begin = current_;
+		const auto lexeme = is_digit(peek()) || peek() == '.' ? number() : identifier();
+		current_ = begin;
+		if (lexeme.empty() && current_ != end_) {
+			return std::string_view(current_, 1u);
+		}
+		return lexeme;
+	}
+
+	uint32_t line() const
+	{
+		return line_;
+	}
+
+	static bool is_digit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+private:
+	static bool is_alpha(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+	}
+
+	void skip_space()
+	{
+		for (; current_ != end_; ++current_) {
+			const auto c = *current_;
+			if (c == '\n') {
+				++line_;
+			} else if (c != ' ' && c != '\t' && c != '\r') {
+				if (c != '/' || current_ + 1 == end_ || current_[1] != '/') {
+					return;
 				}
-				break;
+				current_ = std::find(current_, end_, '\n') - 1;
+			}
+		}
+	}
+
+	std::string_view view(char const* begin) const
+	{
+		return std::string_view(begin, current_ - begin);
+	}
+
+private:
+	char const* current_;
+	char const* end_;
+	uint32_t line_ = 1u;
+};
+
+struct qasm_gate_info {
+	std::string_view name;
+	gate_base op;
+	uint32_t num_params;
+	uint32_t num_controls;
+	uint32_t num_targets;
+};
+
+/* gates of qelib1.inc that have a counterpart in `gate_set`, ordered by expected frequency; angles
+ * of parameterized gates are replaced by the parsed parameter.  As in `write_qasm`, ``cx`` and
+ * ``ccx`` are multiple-controlled Toffoli gates. */
+inline qasm_gate_info const* find_qasm_gate(std::string_view name)
+{
+	static const qasm_gate_info gates[] = {
+	    {"cx", gate::mcx, 0u, 1u, 1u},
+	    {"x", gate::pauli_x, 0u, 0u, 1u},
+	    {"h", gate::hadamard, 0u, 0u, 1u},
+	    {"t", gate::t, 0u, 0u, 1u},
+	    {"tdg", gate::t_dagger, 0u, 0u, 1u},
+	    {"ccx", gate::mcx, 0u, 2u, 1u},
+	    {"rz", gate_base(gate_set::rotation_z), 1u, 0u, 1u},
+	    {"s", gate::phase, 0u, 0u, 1u},
+	    {"sdg", gate::phase_dagger, 0u, 0u, 1u},
+	    {"z", gate::pauli_z, 0u, 0u, 1u},
+	    {"y", gate_base(gate_set::pauli_y, symbolic_angles::one_half), 0u, 0u, 1u},
+	    {"rx", gate_base(gate_set::rotation_x), 1u, 0u, 1u},
+	    {"ry", gate_base(gate_set::rotation_y), 1u, 0u, 1u},
+	    {"u1", gate_base(gate_set::rotation_z), 1u, 0u, 1u},
+	    {"cz", gate::cz, 0u, 1u, 1u},
+	    {"swap", gate::swap, 0u, 0u, 2u},
+	    {"id", gate::identity, 0u, 0u, 1u},
+	    {"CX", gate::mcx, 0u, 1u, 1u},
+	};
+	for (auto const& info : gates) {
+		/* names are short, comparing the first character avoids most calls to memcmp */
+		if (info.name[0] == name[0] && info.name == name) {
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
+template<typename Network, typename = void>
+struct has_reserve : std::false_type {};
+
+template<typename Network>
+struct has_reserve<Network, std::void_t<decltype(std::declval<Network&>().reserve(0u))>>
+    : std::true_type {};
+
+template<typename Network>
+class qasm_parser {
+	using gate_type = typename Network::gate_type;
+
+	struct qasm_register {
+		std::string_view name;
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	/* a single qubit, or all qubits of a register */
+	struct qasm_argument {
+		uint32_t offset;
+		uint32_t size;
+		bool is_register;
+	};
+
+public:
+	qasm_parser(Network& network, char const* begin, char const* end)
+	    : network_(network)
+	    , scanner_(begin, end)
+	    , num_statements_(static_cast<uint32_t>(std::count(begin, end, ';')))
+	{}
+
+	void run()
+	{
+		while (!scanner_.at_end()) {
+			statement();
+		}
+	}
+
+private:
+	void statement()
+	{
+		const auto name = scanner_.identifier();
+		if (name.empty()) {
+			error(fmt::format("unexpected '{}'", scanner_.lexeme()));
+		}
+
+		if (auto const* info = find_qasm_gate(name)) {
+			if (num_statements_ != 0u) {
+				reserve();
+			}
+			gate(*info);
+		} else if (name == "OPENQASM") {
+			const auto version = scanner_.number();
+			if (version.substr(0, 2) != "2." && version != "2") {
+				error(fmt::format("unsupported version {}", version));
+			}
+		} else if (name == "include") {
+			if (scanner_.peek() != '"') {
+				expected("file name");
+			}
+			scanner_.string();
+		} else if (name == "qreg") {
+			const auto [reg, size] = declaration();
+			registers_.push_back({reg, network_.num_qubits(), size});
+			for (auto i = 0u; i < size; ++i) {
+				network_.add_qubit(fmt::format("{}{}", reg, i));
+			}
+		} else if (name == "creg") {
+			declaration();
+		} else if (name == "barrier") {
+			skip_statement();
+			return;
+		} else if (name == "measure") {
+			argument();
+			expect_symbol("->");
+			skip_statement();
+			return;
+		} else if (name == "gate" || name == "opaque" || name == "if" || name == "reset"
+		           || name == "U") {
+			error(fmt::format("unsupported statement '{}'", name));
+		} else {
+			error(fmt::format("unknown gate '{}'", name));
+		}
+		expect_symbol(';');
+	}
+
+	/* preallocates one gate per remaining statement once all registers are declared */
+	void reserve()
+	{
+		if constexpr (has_reserve<Network>::value) {
+			network_.reserve(num_statements_);
+		}
+		num_statements_ = 0u;
+	}
+
+	std::pair<std::string_view, uint32_t> declaration()
+	{
+		const auto name = scanner_.identifier();
+		if (name.empty()) {
+			expected("register name");
+		}
+		expect_symbol('[');
+		const auto size = integer();
+		expect_symbol(']');
+		return {name, size};
+	}
 
-			case 1u:
-				for (auto q : targets) {
-					os << fmt::format("cx q[{}],q[{}];\n", controls[0], q);
+	void gate(qasm_gate_info const& info)
+	{
+		auto op = info.op;
+		if (scanner_.accept('(')) {
+			auto num_params = 0u;
+			double param = 0.0;
+			if (scanner_.peek() != ')') {
+				param = expression();
+				for (num_params = 1u; scanner_.accept(','); ++num_params) {
+					expression();
 				}
-				break;
+			}
+			expect_symbol(')');
+			if (num_params != info.num_params) {
+				error(fmt::format("gate '{}' expects {} parameters", info.name, info.num_params));
+			}
+			if (num_params != 0u) {
+				op = gate_base(info.op.operation(), param);
+			}
+		} else if (info.num_params != 0u) {
+			error(fmt::format("gate '{}' expects {} parameters", info.name, info.num_params));
+		}
 
-			case 2u:
-				for (auto i = 1u; i < targets.size(); ++i) {
-					os << fmt::format("cx q[{}], q[{}];\n", targets[0],
-					                   targets[i]);
+		const auto num_qubits = info.num_controls + info.num_targets;
+		arguments_.clear();
+		uint32_t broadcast = 1u;
+		bool broadcast_register = false;
+		for (auto i = 0u; i < num_qubits; ++i) {
+			if (i != 0u) {
+				expect_symbol(',');
+			}
+			const auto arg = argument();
+			if (arg.is_register) {
+				if (broadcast_register && broadcast != arg.size) {
+					error("registers of different sizes");
 				}
-				os << fmt::format("ccx q[{}], q[{}], q[{}];\n", controls[0],
-				                   controls[1], targets[0]);
-				for (auto i = 1u; i < targets.size(); ++i) {
-					os << fmt::format("cx q[{}], q[{}];\n", targets[0],
-					                   targets[i]);
+				broadcast = arg.size;
+				broadcast_register = true;
+			}
+			arguments_.push_back(arg);
+		}
+
+		for (auto k = 0u; k < broadcast; ++k) {
+			controls_.clear();
+			targets_.clear();
+			for (auto i = 0u; i < num_qubits; ++i) {
+				auto const& arg = arguments_[i];
+				const qubit_id qid(arg.offset + (arg.is_register ? k : 0u));
+				(i < info.num_controls ? controls_ : targets_).push_back(qid);
+			}
+			add_gate(op, info);
+		}
+	}
+
+	void add_gate(gate_base const& op, qasm_gate_info const& info)
+	{
+		for (auto i = 0u; i < controls_.size() + targets_.size(); ++i) {
+			for (auto j = i + 1u; j < controls_.size() + targets_.size(); ++j) {
+				if (qubit(i) == qubit(j)) {
+					error(fmt::format("duplicate qubit in gate '{}'", info.name));
 				}
+			}
+		}
+
+		/* qubits of an empty network are not rewired, therefore gates are constructed in place */
+		if (info.num_controls == 0u && info.num_targets == 1u && op.is_single_qubit()) {
+			network_.emplace_gate(gate_type(op, targets_[0]));
+		} else if (info.num_controls == 1u && info.num_targets == 1u && op.is_double_qubit()) {
+			network_.emplace_gate(gate_type(op, controls_[0], targets_[0]));
+		} else {
+			network_.emplace_gate(gate_type(op, controls_, targets_));
+		}
+	}
+
+	qubit_id qubit(uint32_t i) const
+	{
+		return i < controls_.size() ? controls_[i] : targets_[i - controls_.size()];
+	}
+
+	qasm_argument argument()
+	{
+		const auto name = scanner_.identifier();
+		if (name.empty()) {
+			expected("register name");
+		}
+		auto const* reg = find_register(name);
+		if (reg == nullptr) {
+			error(fmt::format("unknown register '{}'", name));
+		}
+		if (!scanner_.accept('[')) {
+			return {reg->offset, reg->size, true};
+		}
+		const auto index = integer();
+		expect_symbol(']');
+		if (index >= reg->size) {
+			error(fmt::format("index {} out of range for register '{}'", index, name));
+		}
+		return {reg->offset + index, 1u, false};
+	}
+
+	qasm_register const* find_register(std::string_view name) const
+	{
+		for (auto const& reg : registers_) {
+			if (reg.name == name) {
+				return &reg;
+			}
+		}
+		return nullptr;
+	}
+
+	/* expression := term (('+' | '-') term)* */
+	double expression()
+	{
+		auto value = term();
+		for (auto op = scanner_.peek(); op == '+' || op == '-'; op = scanner_.peek()) {
+			scanner_.accept(op);
+			const auto rhs = term();
+			value = op == '+' ? value + rhs : value - rhs;
+		}
+		return value;
+	}
+
+	/* term := unary (('*' | '/') unary)* */
+	double term()
+	{
+		auto value = unary();
+		for (auto op = scanner_.peek(); op == '*' || op == '/'; op = scanner_.peek()) {
+			scanner_.accept(op);
+			const auto rhs = unary();
+			value = op == '*' ? value * rhs : value / rhs;
+		}
+		return value;
+	}
+
+	/* unary := '-' unary | power, such that '^' binds tighter than unary minus */
+	double unary()
+	{
+		if (scanner_.accept('-')) {
+			return -unary();
+		}
+		return power();
+	}
+
+	/* power := primary ('^' unary)? */
+	double power()
+	{
+		const auto value = primary();
+		if (scanner_.accept('^')) {
+			return std::pow(value, unary());
+		}
+		return value;
+	}
+
+	double primary()
+	{
+		const auto c = scanner_.peek();
+		if (qasm_scanner::is_digit(c) || c == '.') {
+			return number(scanner_.number());
+		}
+		if (scanner_.accept('(')) {
+			const auto value = expression();
+			expect_symbol(')');
+			return value;
+		}
+		const auto name = scanner_.identifier();
+		if (name == "pi") {
+			return M_PI;
+		}
+		double (*fn)(double) = nullptr;
+		if (name == "sin") {
+			fn = [](double x) { return std::sin(x); };
+		} else if (name == "cos") {
+			fn = [](double x) { return std::cos(x); };
+		} else if (name == "tan") {
+			fn = [](double x) { return std::tan(x); };
+		} else if (name == "exp") {
+			fn = [](double x) { return std::exp(x); };
+		} else if (name == "ln") {
+			fn = [](double x) { return std::log(x); };
+		} else if (name == "sqrt") {
+			fn = [](double x) { return std::sqrt(x); };
+		}
+		if (fn == nullptr) {
+			error(fmt::format("unexpected '{}' in expression",
+			                  name.empty() ? scanner_.lexeme() : name));
+		}
+		expect_symbol('(');
+		const auto value = expression();
+		expect_symbol(')');
+		return fn(value);
+	}
+
+	double number(std::string_view text) const
+	{
+		/* Fast path for decimals with at most 15 digits: mantissa and power of ten are exact
+		 * doubles, hence their quotient is correctly rounded and equal to the result of strtod */
+		static constexpr double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+		                                           1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+		uint64_t mantissa = 0u;
+		uint32_t num_digits = 0u;
+		int32_t num_decimals = -1;
+		for (auto c : text) {
+			if (qasm_scanner::is_digit(c)) {
+				mantissa = mantissa * 10u + static_cast<uint32_t>(c - '0');
+				num_decimals += num_decimals >= 0 ? 1 : 0;
+				++num_digits;
+			} else if (c == '.' && num_decimals < 0) {
+				num_decimals = 0;
+			} else {
+				num_digits = 16u;
 				break;
 			}
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("x q[{}];\n", control.index());
-				}
-			});
-		} break;
 		}
-		return true;
-	});
-}
+		if (num_digits != 0u && num_digits <= 15u) {
+			return static_cast<double>(mantissa) / powers_of_ten[std::max(num_decimals, 0)];
+		}
 
-/*! \brief Writes network in OPENQASM 2.0 format into a file
+		/* the buffer is not null-terminated */
+		char buffer[64];
+		if (text.size() >= sizeof(buffer)) {
+			error(fmt::format("invalid number '{}'", text));
+		}
+		std::memcpy(buffer, text.data(), text.size());
+		buffer[text.size()] = '\0';
+		char* end;
+		const auto value = std::strtod(buffer, &end);
+		if (end != buffer + text.size()) {
+			error(fmt::format("invalid number '{}'", text));
+		}
+		return value;
+	}
+
+	uint32_t integer()
+	{
+		const auto text = scanner_.number();
+		if (text.empty()) {
+			expected("integer");
+		}
+		uint64_t value = 0u;
+		for (auto c : text) {
+			if (!qasm_scanner::is_digit(c) || value > 0xffffffffu / 10u) {
+				error(fmt::format("invalid integer '{}'", text));
+			}
+			value = value * 10u + static_cast<uint32_t>(c - '0');
+		}
+		if (value > 0xffffffffu) {
+			error(fmt::format("invalid integer '{}'", text));
+		}
+		return static_cast<uint32_t>(value);
+	}
+
+	void skip_statement()
+	{
+		while (!scanner_.accept(';')) {
+			if (scanner_.at_end()) {
+				error("missing ';'");
+			}
+			const auto lexeme = scanner_.lexeme();
+			if (lexeme.size() == 1u && lexeme[0] == '"') {
+				scanner_.string();
+			} else {
+				scanner_.accept(lexeme);
+			}
+		}
+	}
+
+	template<typename Symbol>
+	void expect_symbol(Symbol symbol)
+	{
+		if (!scanner_.accept(symbol)) {
+			error(fmt::format("expected '{}', got '{}'", symbol, scanner_.lexeme()));
+		}
+	}
+
+	[[noreturn]] void expected(char const* what)
+	{
+		error(fmt::format("expected {}, got '{}'", what, scanner_.lexeme()));
+	}
+
+	[[noreturn]] void error(std::string const& message) const
+	{
+		throw std::runtime_error(fmt::format("qasm:{}: {}", scanner_.line(), message));
+	}
+
+private:
+	Network& network_;
+	qasm_scanner scanner_;
+	std::vector<qasm_register> registers_;
+	std::vector<qasm_argument> arguments_;
+	std::vector<qubit_id> controls_;
+	std::vector<qubit_id> targets_;
+	uint32_t num_statements_;
+};
+
+} // namespace detail
+
+/*! \brief Reads an OPENQASM 2.0 program from a buffer into an empty network
+ *
+ * Supports register declarations and the gates of ``qelib1.inc`` that have a counterpart in
+ * `gate_set` (``id``, ``x``, ``y``, ``z``, ``h``, ``s``, ``sdg``, ``t``, ``tdg``, ``rx``, ``ry``,
+ * ``rz``, ``u1``, ``cx``, ``cz``, ``ccx``, ``swap``), including register broadcasting.  The
+ * gate ``u1`` is read as ``rz``, which is equal up to global phase.  ``creg``, ``barrier``,
+ * and ``measure`` statements are parsed and ignored.  Gate definitions, classical control, and
+ * ``reset`` are not supported.  Errors are reported with a `std::runtime_error`, whose message
+ * contains the line number.
+ *
+ * Before the first gate is added, the storage of the network is preallocated for one gate per
+ * remaining ``;`` in the buffer, if the network has a ``reserve`` method.  The qubits of register ``q`` are labeled ``q0``, ``q1``,
+ * etc.
  *
- * **Required gate functions:**
- * - `foreach_control`
- * - `foreach_target`
- * - `op`
- * 
  * **Required network functions:**
+ * - `add_qubit`
+ * - `emplace_gate`
  * - `num_qubits`
- * - `foreach_cnode`
  *
- * \param network A quantum network
+ * \param network An empty quantum network
+ * \param data Pointer to the program text (does not need to be null-terminated)
+ * \param size Size of the program text
+ */
+template<typename Network>
+void read_qasm_from_buffer(Network& network, char const* data, std::size_t size)
+{
+	detail::qasm_parser<Network> parser(network, data, data + size);
+	parser.run();
+}
+
+/*! \brief Reads an OPENQASM 2.0 program from an input stream into an empty network
+ *
+ * \param network An empty quantum network
+ * \param is Input stream
+ */
+template<typename Network>
+void read_qasm(Network& network, std::istream& is)
+{
+	const std::string text((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	read_qasm_from_buffer(network, text.data(), text.size());
+}
+
+/*! \brief Reads an OPENQASM 2.0 file into an empty network
+ *
+ * The file is memory mapped and tokens are read directly from the mapped memory.
+ *
+ * \param network An empty quantum network
  * \param filename Filename
  */
 template<typename Network>
-void write_qasm(Network const& network, std::string const& filename)
+void read_qasm(Network& network, std::string const& filename)
 {
-	std::ofstream os(filename.c_str(), std::ofstream::out);
-	write_qasm(network, os);
+	detail::mapped_file file(filename);
+	read_qasm_from_buffer(network, file.data(), file.size());
 }
+#pragma endregion
 
 } // namespace tweedledum
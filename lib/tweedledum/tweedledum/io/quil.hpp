@@ -7,14 +7,128 @@
 
 #include "../gates/gate_set.hpp"
 #include "../networks/qubit.hpp"
+#include "../utils/detail/output_buffer.hpp"
 
 #include <cassert>
 #include <fmt/format.h>
 #include <fstream>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace tweedledum {
 
+namespace detail {
+
+/* writes the Quil instructions of a single gate into a buffer */
+template<typename Gate>
+void write_quil_gate(Gate const& gate, fmt::memory_buffer& buffer)
+{
+	switch (gate.operation()) {
+	default:
+		std::cerr << "[w] unsupported gate type\n";
+		assert(0);
+		return;
+
+	case gate_set::hadamard:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "H {}\n", target); });
+		break;
+
+	case gate_set::pauli_x:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "X {}\n", target); });
+		break;
+
+	case gate_set::t:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "T {}\n", target); });
+		break;
+
+	case gate_set::t_dagger:
+		gate.foreach_target([&](auto target) { fmt::format_to(buffer, "RZ(-pi/4) {}\n", target); });
+		break;
+
+	case gate_set::rotation_z:
+		gate.foreach_target([&](auto target) {
+			fmt::format_to(buffer, "RZ({}) {}\n", gate.rotation_angle().numeric_value(), target);
+		});
+		break;
+
+	case gate_set::cx:
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "X {}\n", control.index());
+			}
+			gate.foreach_target([&](auto target) {
+				fmt::format_to(buffer, "CNOT {} {}\n", control.index(), target); 
+			});
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "X {}\n", control.index());
+			}
+		});
+		break;
+	
+	case gate_set::swap: {
+		std::vector<qubit_id> targets;
+		gate.foreach_target([&](auto target) {
+			targets.push_back(target);
+		});
+		fmt::format_to(buffer, "CNOT {} {}\n", targets[0], targets[1]);
+		fmt::format_to(buffer, "CNOT {} {}\n", targets[1], targets[0]);
+		fmt::format_to(buffer, "CNOT {} {}\n", targets[0], targets[1]);
+	} break;
+
+	case gate_set::mcx: {
+		std::vector<qubit_id> controls;
+		std::vector<qubit_id> targets;
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "X {}\n", control.index());
+			}
+			controls.push_back(control.index()); 
+		});
+		gate.foreach_target([&](auto target) {
+			targets.push_back(target);
+		});
+		switch (controls.size()) {
+		default:
+			std::cerr << "[w] unsupported control size\n";
+			assert(0);
+			return;
+
+		case 0u:
+			for (auto target : targets) {
+				fmt::format_to(buffer, "X {}\n", target);
+			}
+			break;
+
+		case 1u:
+			for (auto target : targets) {
+				fmt::format_to(buffer, "CNOT {} {}\n", controls[0], target);
+			}
+			break;
+
+		case 2u:
+			for (auto i = 1u; i < targets.size(); ++i) {
+				fmt::format_to(buffer, "CNOT {} {}\n", targets[0], targets[i]);
+			}
+			fmt::format_to(buffer, "CCNOT {} {} {}\n", controls[0], controls[1],
+			               targets[0]);
+			for (auto i = 1u; i < targets.size(); ++i) {
+				fmt::format_to(buffer, "CNOT {} {}\n", targets[0], targets[i]);
+			}
+			break;
+		}
+		gate.foreach_control([&](auto control) {
+			if (control.is_complemented()) {
+				fmt::format_to(buffer, "X {}\n", control.index());
+			}
+		});
+	} break;
+	}
+}
+
+} // namespace detail
+
 /*! \brief Writes network in quil format into output stream
  *
  * An overloaded variant exists that writes the network into a file.
@@ -35,110 +149,13 @@ namespace tweedledum {
 template<typename Network>
 void write_quil(Network const& network, std::ostream& os)
 {
+	fmt::memory_buffer buffer;
 	network.foreach_cgate([&](auto const& node) {
-		auto const& gate = node.gate;
-		switch (gate.operation()) {
-		default:
-			std::cerr << "[w] unsupported gate type\n";
-			assert(0);
-			return true;
-
-		case gate_set::hadamard:
-			gate.foreach_target([&](auto target) { os << fmt::format("H {}\n", target); });
-			break;
-
-		case gate_set::pauli_x:
-			gate.foreach_target([&](auto target) { os << fmt::format("X {}\n", target); });
-			break;
-
-		case gate_set::t:
-			gate.foreach_target([&](auto target) { os << fmt::format("T {}\n", target); });
-			break;
-
-		case gate_set::t_dagger:
-			gate.foreach_target([&](auto target) { os << fmt::format("RZ(-pi/4) {}\n", target); });
-			break;
-
-		case gate_set::rotation_z:
-			gate.foreach_target([&](auto target) {
-				os << fmt::format("RZ({}) {}\n", gate.rotation_angle().numeric_value(), target);
-			});
-			break;
-
-		case gate_set::cx:
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("X {}\n", control.index());
-				}
-				gate.foreach_target([&](auto target) {
-					os << fmt::format("CNOT {} {}\n", control.index(), target); 
-				});
-				if (control.is_complemented()) {
-					os << fmt::format("X {}\n", control.index());
-				}
-			});
-			break;
-		
-		case gate_set::swap: {
-			std::vector<qubit_id> targets;
-			gate.foreach_target([&](auto target) {
-				targets.push_back(target);
-			});
-			os << fmt::format("CNOT {} {}\n", targets[0], targets[1]);
-			os << fmt::format("CNOT {} {}\n", targets[1], targets[0]);
-			os << fmt::format("CNOT {} {}\n", targets[0], targets[1]);
-		} break;
-
-		case gate_set::mcx: {
-			std::vector<qubit_id> controls;
-			std::vector<qubit_id> targets;
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("X {}\n", control.index());
-				}
-				controls.push_back(control.index()); 
-			});
-			gate.foreach_target([&](auto target) {
-				targets.push_back(target);
-			});
-			switch (controls.size()) {
-			default:
-				std::cerr << "[w] unsupported control size\n";
-				assert(0);
-				return true;
-
-			case 0u:
-				for (auto target : targets) {
-					os << fmt::format("X {}\n", target);
-				}
-				break;
-
-			case 1u:
-				for (auto target : targets) {
-					os << fmt::format("CNOT {} {}\n", controls[0], target);
-				}
-				break;
-
-			case 2u:
-				for (auto i = 1u; i < targets.size(); ++i) {
-					os << fmt::format("CNOT {} {}\n", targets[0], targets[i]);
-				}
-				os << fmt::format("CCNOT {} {} {}\n", controls[0], controls[1],
-				                   targets[0]);
-				for (auto i = 1u; i < targets.size(); ++i) {
-					os << fmt::format("CNOT {} {}\n", targets[0], targets[i]);
-				}
-				break;
-			}
-			gate.foreach_control([&](auto control) {
-				if (control.is_complemented()) {
-					os << fmt::format("X {}\n", control.index());
-				}
-			});
-		} break;
-		}
+		detail::write_quil_gate(node.gate, buffer);
+		detail::flush_buffer(buffer, os, detail::output_chunk_size);
 		return true;
 	});
+	detail::flush_buffer(buffer, os);
 }
 
 /*! \brief Writes network in quil format into a file
@@ -160,7 +177,46 @@ template<typename Network>
 void write_quil(Network const& network, std::string const& filename)
 {
 	std::ofstream os(filename.c_str(), std::ofstream::out);
+	if (!os) {
+		throw std::runtime_error(fmt::format("cannot open file '{}'", filename));
+	}
 	write_quil(network, os);
 }
 
+/*! \brief Writes gates in quil format one at a time
+ *
+ * This writer can be used with a `gate_sink` to write circuits that are too large to be stored.
+ *
+ * \param os Output stream
+ */
+class quil_stream_writer {
+public:
+	explicit quil_stream_writer(std::ostream& os)
+	    : os_(os)
+	{}
+
+	qubit_id add_qubit(std::string const&)
+	{
+		return qubit_id(num_qubits_++);
+	}
+
+	template<class Gate>
+	void write_gate(Gate const& gate)
+	{
+		detail::write_quil_gate(gate, buffer_);
+		detail::flush_buffer(buffer_, os_, detail::output_chunk_size);
+	}
+
+	void finish()
+	{
+		detail::flush_buffer(buffer_, os_);
+		os_.flush();
+	}
+
+private:
+	std::ostream& os_;
+	fmt::memory_buffer buffer_;
+	uint32_t num_qubits_ = 0u;
+};
+
 } // namespace tweedledum
@@ -0,0 +1,182 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "../gates/gate_base.hpp"
+#include "qubit.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace tweedledum {
+
+/*! \brief Lightweight network that records gates for replaying them later
+ *
+ * The recorder implements the subset of the network interface that synthesis algorithms use to
+ * add gates (``add_qubit``, ``add_gate``, and ``rewire``).  Gates are stored on local qubit
+ * indexes in a single contiguous buffer.  A recorded circuit can be replayed into any network
+ * using ``replay``, which maps every local qubit to a qubit of the target network.  This makes it
+ * possible to synthesize a sub-circuit once (or in a different thread) and splice it into a
+ * network later.
+ */
+class gate_recorder {
+public:
+	struct gate_entry {
+		gate_base op;
+		uint32_t offset;
+		uint32_t num_controls;
+		uint32_t num_targets;
+	};
+
+#pragma region Types and constructors
+	gate_recorder() = default;
+
+	explicit gate_recorder(uint32_t num_qubits)
+	{
+		for (auto i = 0u; i < num_qubits; ++i) {
+			add_qubit();
+		}
+	}
+#pragma endregion
+
+#pragma region Network interface
+	qubit_id add_qubit()
+	{
+		qubit_id qid(rewiring_map_.size());
+		rewiring_map_.push_back(qid);
+		return qid;
+	}
+
+	uint32_t num_qubits() const
+	{
+		return rewiring_map_.size();
+	}
+
+	uint32_t num_gates() const
+	{
+		return gates_.size();
+	}
+
+	void add_gate(gate_base op, qubit_id target)
+	{
+		gates_.push_back({op, static_cast<uint32_t>(qubits_.size()), 0u, 1u});
+		qubits_.push_back(rewiring_map_.at(target));
+	}
+
+	void add_gate(gate_base op, qubit_id control, qubit_id target)
+	{
+		gates_.push_back({op, static_cast<uint32_t>(qubits_.size()), 1u, 1u});
+		qubits_.emplace_back(rewiring_map_.at(control), control.is_complemented());
+		qubits_.push_back(rewiring_map_.at(target));
+	}
+
+	void add_gate(gate_base op, std::vector<qubit_id> const& controls,
+	              std::vector<qubit_id> const& targets)
+	{
+		gates_.push_back({op, static_cast<uint32_t>(qubits_.size()),
+		                  static_cast<uint32_t>(controls.size()),
+		                  static_cast<uint32_t>(targets.size())});
+		for (auto control : controls) {
+			qubits_.emplace_back(rewiring_map_.at(control), control.is_complemented());
+		}
+		for (auto target : targets) {
+			qubits_.push_back(rewiring_map_.at(target));
+		}
+	}
+
+	void rewire(std::vector<std::pair<uint32_t, uint32_t>> const& transpositions)
+	{
+		for (auto&& [i, j] : transpositions) {
+			std::swap(rewiring_map_[i], rewiring_map_[j]);
+			transpositions_.emplace_back(i, j);
+		}
+	}
+#pragma endregion
+
+#pragma region Properties and iterators
+	/*! \brief Returns true if the recorded circuit changes the qubit wiring. */
+	bool is_rewired() const
+	{
+		return !transpositions_.empty();
+	}
+
+	/*! \brief Calls ``fn(entry, qubits)`` for each gate, where ``qubits`` points to the controls
+	 * followed by the targets of the gate. */
+	template<typename Fn>
+	void foreach_gate(Fn&& fn) const
+	{
+		for (auto const& entry : gates_) {
+			fn(entry, qubits_.data() + entry.offset);
+		}
+	}
+#pragma endregion
+
+#pragma region Replay
+	/*! \brief Adds all recorded gates to ``network``
+	 *
+	 * The local qubit ``i`` is mapped to ``qubits[i]``.  Complemented qubits in ``qubits`` invert
+	 * the polarity of controls on these qubits.  If the recorded circuit rewired qubits,
+	 * the same rewiring is applied to ``network`` after all gates have been added.
+	 */
+	template<class Network>
+	void replay(Network& network, std::vector<qubit_id> const& qubits) const
+	{
+		assert(qubits.size() >= num_qubits());
+
+		std::vector<qubit_id> controls, targets;
+		foreach_gate([&](auto const& entry, qubit_id const* gate_qubits) {
+			if (entry.num_controls == 0u && entry.num_targets == 1u
+			    && entry.op.is_single_qubit()) {
+				network.add_gate(entry.op, qubits[gate_qubits[0].index()]);
+				return;
+			}
+			if (entry.num_controls == 1u && entry.num_targets == 1u
+			    && entry.op.is_double_qubit()) {
+				network.add_gate(entry.op, map(gate_qubits[0], qubits),
+				                 qubits[gate_qubits[1].index()]);
+				return;
+			}
+
+			controls.clear();
+			targets.clear();
+			for (auto i = 0u; i < entry.num_controls; ++i) {
+				controls.push_back(map(gate_qubits[i], qubits));
+			}
+			for (auto i = 0u; i < entry.num_targets; ++i) {
+				targets.push_back(qubits[gate_qubits[entry.num_controls + i].index()]);
+			}
+			network.add_gate(entry.op, controls, targets);
+		});
+
+		if (is_rewired()) {
+			auto transpositions = transpositions_;
+			for (auto&& [i, j] : transpositions) {
+				i = qubits[i];
+				j = qubits[j];
+			}
+			network.rewire(transpositions);
+		}
+	}
+#pragma endregion
+
+private:
+	static qubit_id map(qubit_id qid, std::vector<qubit_id> const& qubits)
+	{
+		auto const& mapped = qubits[qid.index()];
+		return qubit_id(mapped.index(), mapped.is_complemented() != qid.is_complemented());
+	}
+
+private:
+	std::vector<gate_entry> gates_;
+	std::vector<qubit_id> qubits_;
+	std::vector<qubit_id> rewiring_map_;
+	std::vector<std::pair<uint32_t, uint32_t>> transpositions_;
+};
+
+} // namespace tweedledum
@@ -0,0 +1,173 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include "../gates/gate_base.hpp"
+#include "qubit.hpp"
+
+#include <cstdint>
+#include <fmt/format.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tweedledum {
+
+/*! \brief Network that passes every gate to a writer instead of storing it
+ *
+ * The sink implements the subset of the network interface that synthesis algorithms use to add
+ * gates (``add_qubit``, ``add_gate``, and ``rewire``).  As in `netlist`, gates are added on the
+ * qubits of the current rewiring map, and are then immediately passed to ``writer.write_gate``,
+ * such that the memory usage does not depend on the number of gates.  Qubits are announced to
+ * the writer with ``writer.add_qubit(label)``.
+ *
+ * Writers for OPENQASM (`qasm_stream_writer`), Quil (`quil_stream_writer`), and the binary
+ * format (`binary_writer`) are available.  It is the responsibility of the caller to finish the
+ * writer after all gates have been added.
+ */
+template<class Writer>
+class gate_sink {
+public:
+	/*! \brief Gate that is passed to the writer, it is only valid during ``write_gate``. */
+	class gate_type : public gate_base {
+	public:
+		gate_type(gate_base const& op, qubit_id const* qubits, uint32_t num_controls,
+		          uint32_t num_targets)
+		    : gate_base(op)
+		    , qubits_(qubits)
+		    , num_controls_(num_controls)
+		    , num_targets_(num_targets)
+		{}
+
+		uint32_t num_controls() const
+		{
+			return num_controls_;
+		}
+
+		uint32_t num_targets() const
+		{
+			return num_targets_;
+		}
+
+		template<typename Fn>
+		void foreach_control(Fn&& fn) const
+		{
+			for (auto i = 0u; i < num_controls_; ++i) {
+				fn(qubits_[i]);
+			}
+		}
+
+		template<typename Fn>
+		void foreach_target(Fn&& fn) const
+		{
+			for (auto i = num_controls_; i < num_controls_ + num_targets_; ++i) {
+				fn(qubits_[i]);
+			}
+		}
+
+	private:
+		qubit_id const* qubits_;
+		uint32_t num_controls_;
+		uint32_t num_targets_;
+	};
+
+#pragma region Types and constructors
+	explicit gate_sink(Writer& writer)
+	    : writer_(writer)
+	{}
+#pragma endregion
+
+#pragma region Qubits
+	qubit_id add_qubit(std::string const& qlabel)
+	{
+		qubit_id qid(static_cast<uint32_t>(rewiring_map_.size()));
+		rewiring_map_.push_back(qid);
+		writer_.add_qubit(qlabel);
+		return qid;
+	}
+
+	qubit_id add_qubit()
+	{
+		return add_qubit(fmt::format("q{}", rewiring_map_.size()));
+	}
+
+	uint32_t num_qubits() const
+	{
+		return static_cast<uint32_t>(rewiring_map_.size());
+	}
+
+	uint64_t num_gates() const
+	{
+		return num_gates_;
+	}
+#pragma endregion
+
+#pragma region Add gates
+	void add_gate(gate_base op, qubit_id target)
+	{
+		qubits_.clear();
+		qubits_.push_back(rewiring_map_.at(target));
+		write_gate(op, 0u, 1u);
+	}
+
+	void add_gate(gate_base op, qubit_id control, qubit_id target)
+	{
+		qubits_.clear();
+		qubits_.emplace_back(rewiring_map_.at(control), control.is_complemented());
+		qubits_.push_back(rewiring_map_.at(target));
+		write_gate(op, 1u, 1u);
+	}
+
+	void add_gate(gate_base op, std::vector<qubit_id> const& controls,
+	              std::vector<qubit_id> const& targets)
+	{
+		qubits_.clear();
+		for (auto control : controls) {
+			qubits_.emplace_back(rewiring_map_.at(control), control.is_complemented());
+		}
+		for (auto target : targets) {
+			qubits_.push_back(rewiring_map_.at(target));
+		}
+		write_gate(op, static_cast<uint32_t>(controls.size()),
+		           static_cast<uint32_t>(targets.size()));
+	}
+#pragma endregion
+
+#pragma region Rewiring
+	void rewire(std::vector<uint32_t> const& rewiring_map)
+	{
+		rewiring_map_ = rewiring_map;
+	}
+
+	void rewire(std::vector<std::pair<uint32_t, uint32_t>> const& transpositions)
+	{
+		for (auto&& [i, j] : transpositions) {
+			std::swap(rewiring_map_[i], rewiring_map_[j]);
+		}
+	}
+
+	std::vector<uint32_t> const& rewire_map() const
+	{
+		return rewiring_map_;
+	}
+#pragma endregion
+
+private:
+	void write_gate(gate_base const& op, uint32_t num_controls, uint32_t num_targets)
+	{
+		writer_.write_gate(gate_type(op, qubits_.data(), num_controls, num_targets));
+		++num_gates_;
+	}
+
+private:
+	Writer& writer_;
+	std::vector<uint32_t> rewiring_map_;
+	/* qubits of the current gate, controls are followed by targets */
+	std::vector<qubit_id> qubits_;
+	uint64_t num_gates_ = 0u;
+};
+
+} // namespace tweedledum
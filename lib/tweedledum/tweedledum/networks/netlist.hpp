@@ -83,6 +83,12 @@ public:
 	{
 		return (storage_->nodes.size() - storage_->inputs.size());
 	}
+
+	/*! \brief Reserves storage for ``num_gates`` additional gates. */
+	void reserve(uint32_t num_gates)
+	{
+		storage_->nodes.reserve(storage_->nodes.size() + num_gates);
+	}
 #pragma endregion
 
 #pragma region Nodes
@@ -9,6 +9,7 @@
 #include "dynamic_bitset.hpp"
 #include "foreach.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <fmt/format.h>
 #include <iostream>
@@ -82,6 +83,28 @@ public:
 		}
 		return value;
 	}
+
+	/*! \brief Checks whether all bits of a row are set in a subset of the columns. */
+	bool row_all(std::vector<uint32_t> const& columns, size_type row_index) const
+	{
+		return std::all_of(columns.begin(), columns.end(), [&](auto column_index) {
+			return column(column_index)[row_index];
+		});
+	}
+
+	/*! \brief Counts the bits that are set in a row in a subset of the columns. */
+	size_type row_count(std::vector<uint32_t> const& columns, size_type row_index) const
+	{
+		return std::count_if(columns.begin(), columns.end(), [&](auto column_index) {
+			return column(column_index)[row_index];
+		});
+	}
+
+	/*! \brief Counts the bits that are set in a column. */
+	size_type column_count(size_type column_index) const
+	{
+		return column(column_index).count();
+	}
 #pragma endregion
 
 #pragma region Iterators
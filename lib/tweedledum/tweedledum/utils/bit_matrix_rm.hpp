@@ -10,6 +10,7 @@
 #include "foreach.hpp"
 #include "permute.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <fmt/format.h>
 #include <iostream>
@@ -36,7 +37,7 @@ public:
 	{}
 
 	bit_matrix_rm(size_type num_rows, size_type num_columns)
-	    : storage_(num_rows, num_columns)
+	    : storage_(num_columns, num_rows)
 	{}
 
 	template<typename ValueType>
@@ -74,6 +75,32 @@ public:
 		}
 		return value;
 	}
+
+	/*! \brief Checks whether all bits of a row are set in a subset of the columns. */
+	bool row_all(std::vector<uint32_t> const& columns, size_type row_index) const
+	{
+		auto const& value = row(row_index);
+		return std::all_of(columns.begin(), columns.end(),
+		                   [&](auto column_index) { return value[column_index]; });
+	}
+
+	/*! \brief Counts the bits that are set in a row in a subset of the columns. */
+	size_type row_count(std::vector<uint32_t> const& columns, size_type row_index) const
+	{
+		auto const& value = row(row_index);
+		return std::count_if(columns.begin(), columns.end(),
+		                     [&](auto column_index) { return value[column_index]; });
+	}
+
+	/*! \brief Counts the bits that are set in a column. */
+	size_type column_count(size_type column_index) const
+	{
+		size_type count = 0;
+		for (auto const& value : storage_.lines_) {
+			count += value[column_index];
+		}
+		return count;
+	}
 #pragma endregion
 
 #pragma region Iterators
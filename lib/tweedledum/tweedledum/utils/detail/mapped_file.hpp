@@ -0,0 +1,93 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstddef>
+#include <fmt/format.h>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tweedledum::detail {
+
+/*! \brief Read-only view of a file that is memory mapped, if possible. */
+class mapped_file {
+public:
+	explicit mapped_file(std::string const& filename)
+	{
+#if defined(_WIN32)
+		std::ifstream is(filename, std::ios::binary);
+		if (!is) {
+			throw std::runtime_error(fmt::format("cannot open file '{}'", filename));
+		}
+		buffer_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+		data_ = buffer_.data();
+		size_ = buffer_.size();
+#else
+		const auto fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error(fmt::format("cannot open file '{}'", filename));
+		}
+		struct stat st;
+		if (::fstat(fd, &st) != 0) {
+			::close(fd);
+			throw std::runtime_error(fmt::format("cannot stat file '{}'", filename));
+		}
+		size_ = static_cast<std::size_t>(st.st_size);
+		if (size_ != 0u) {
+			auto* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED) {
+				::close(fd);
+				throw std::runtime_error(fmt::format("cannot map file '{}'", filename));
+			}
+			::madvise(data, size_, MADV_SEQUENTIAL);
+			data_ = static_cast<char const*>(data);
+		}
+		::close(fd);
+#endif
+	}
+
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+
+	~mapped_file()
+	{
+#if !defined(_WIN32)
+		if (data_ != nullptr) {
+			::munmap(const_cast<char*>(data_), size_);
+		}
+#endif
+	}
+
+	char const* data() const
+	{
+		return data_;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+private:
+	char const* data_ = nullptr;
+	std::size_t size_ = 0u;
+#if defined(_WIN32)
+	std::vector<char> buffer_;
+#endif
+};
+
+} // namespace tweedledum::detail
@@ -0,0 +1,28 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstddef>
+#include <fmt/format.h>
+#include <ostream>
+
+namespace tweedledum::detail {
+
+/* writers format code into a memory buffer and pass it to the output stream in chunks of about
+ * this size, instead of performing one (formatted) stream operation per statement */
+constexpr std::size_t output_chunk_size = std::size_t(1) << 16;
+
+/*! \brief Writes the buffer into the stream and clears it, if it holds at least `min_size` bytes */
+inline void flush_buffer(fmt::memory_buffer& buffer, std::ostream& os, std::size_t min_size = 0u)
+{
+	if (buffer.size() == 0u || buffer.size() < min_size) {
+		return;
+	}
+	os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+	buffer.resize(0u);
+}
+
+} // namespace tweedledum::detail
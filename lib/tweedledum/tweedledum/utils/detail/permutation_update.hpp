@@ -0,0 +1,224 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TWEEDLEDUM_PERMUTATION_SIMD 1
+#include <immintrin.h>
+#else
+#define TWEEDLEDUM_PERMUTATION_SIMD 0
+#endif
+
+namespace tweedledum::detail {
+
+/*! \brief Instruction set used for permutation updates. */
+enum class simd_level : uint8_t {
+	scalar,
+	avx2,
+	avx512,
+};
+
+/* Kernels for applying a multiple-controlled Toffoli gate with control mask ``controls`` and
+ * target mask ``targets`` to a permutation of ``size`` elements, where ``size`` is a power of 2.
+ * The ``update`` kernel applies the gate to the outputs of the permutation (all values ``z`` that
+ * contain ``controls`` are XORed with ``targets``), the ``update_inv`` kernel applies the gate to
+ * the inputs of the permutation (entries ``i`` and ``i ^ targets`` are swapped for all indexes
+ * ``i`` that contain ``controls``). */
+struct permutation_update_kernels {
+	void (*update)(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets);
+	void (*update_inv)(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets);
+};
+
+#pragma region Scalar kernels
+inline void update_permutation_scalar(uint32_t* data, uint32_t size, uint32_t controls,
+                                      uint32_t targets)
+{
+	for (auto i = 0u; i < size; ++i) {
+		if ((data[i] & controls) == controls) {
+			data[i] ^= targets;
+		}
+	}
+}
+
+inline void update_permutation_inv_scalar(uint32_t* data, uint32_t size, uint32_t controls,
+                                          uint32_t targets)
+{
+	for (auto i = 0u; i < size; ++i) {
+		if ((i & controls) != controls) {
+			continue;
+		}
+		if (const auto partner = i ^ targets; partner > i) {
+			std::swap(data[i], data[partner]);
+		}
+	}
+}
+
+/* The vectorized inverse kernels swap aligned blocks of ``lanes`` entries at once, which is
+ * possible if no target bit addresses a lane inside a block.  Blocks whose index does not contain
+ * the upper control bits are skipped, and the lower control bits translate into a fixed mask of
+ * lanes to swap. */
+struct inv_block_plan {
+	inv_block_plan(uint32_t lanes, uint32_t controls, uint32_t targets)
+	    : high(1u << (31u - __builtin_clz(targets)))
+	    , block_controls(controls & ~(lanes - 1u))
+	{
+		const auto lane_controls = controls & (lanes - 1u);
+		for (auto lane = 0u; lane < lanes; ++lane) {
+			if ((lane & lane_controls) == lane_controls) {
+				lane_mask |= 1u << lane;
+			}
+		}
+	}
+
+	/* highest target bit, a block is only swapped from the half where this bit is 0 */
+	uint32_t high;
+	uint32_t block_controls;
+	uint32_t lane_mask = 0u;
+};
+#pragma endregion
+
+#if TWEEDLEDUM_PERMUTATION_SIMD
+#pragma region AVX2 kernels
+__attribute__((target("avx2"))) inline void
+update_permutation_avx2(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets)
+{
+	const auto vcontrols = _mm256_set1_epi32(controls);
+	const auto vtargets = _mm256_set1_epi32(targets);
+
+	auto i = 0u;
+	for (; i + 8u <= size; i += 8u) {
+		auto z = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+		const auto mask = _mm256_cmpeq_epi32(_mm256_and_si256(z, vcontrols), vcontrols);
+		z = _mm256_xor_si256(z, _mm256_and_si256(mask, vtargets));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), z);
+	}
+	update_permutation_scalar(data + i, size - i, controls, targets);
+}
+
+__attribute__((target("avx2"))) inline void
+update_permutation_inv_avx2(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets)
+{
+	if (size < 8u || (targets & 7u) != 0u) {
+		update_permutation_inv_scalar(data, size, controls, targets);
+		return;
+	}
+
+	const inv_block_plan plan(8u, controls, targets);
+	const auto mask = _mm256_setr_epi32(
+	    -(plan.lane_mask & 1), -((plan.lane_mask >> 1) & 1), -((plan.lane_mask >> 2) & 1),
+	    -((plan.lane_mask >> 3) & 1), -((plan.lane_mask >> 4) & 1), -((plan.lane_mask >> 5) & 1),
+	    -((plan.lane_mask >> 6) & 1), -((plan.lane_mask >> 7) & 1));
+	for (auto chunk = 0u; chunk < size; chunk += 2u * plan.high) {
+		for (auto i = chunk; i < chunk + plan.high; i += 8u) {
+			if ((i & plan.block_controls) != plan.block_controls) {
+				continue;
+			}
+			auto* pi = reinterpret_cast<__m256i*>(data + i);
+			auto* pj = reinterpret_cast<__m256i*>(data + (i ^ targets));
+			const auto a = _mm256_loadu_si256(pi);
+			const auto b = _mm256_loadu_si256(pj);
+			_mm256_storeu_si256(pi, _mm256_blendv_epi8(a, b, mask));
+			_mm256_storeu_si256(pj, _mm256_blendv_epi8(b, a, mask));
+		}
+	}
+}
+#pragma endregion
+
+#pragma region AVX-512 kernels
+__attribute__((target("avx512f"))) inline void
+update_permutation_avx512(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets)
+{
+	const auto vcontrols = _mm512_set1_epi32(controls);
+	const auto vtargets = _mm512_set1_epi32(targets);
+
+	auto i = 0u;
+	for (; i + 16u <= size; i += 16u) {
+		const auto z = _mm512_loadu_si512(data + i);
+		const auto mask = _mm512_cmpeq_epi32_mask(_mm512_and_si512(z, vcontrols), vcontrols);
+		_mm512_storeu_si512(data + i, _mm512_mask_xor_epi32(z, mask, z, vtargets));
+	}
+	update_permutation_scalar(data + i, size - i, controls, targets);
+}
+
+__attribute__((target("avx512f"))) inline void
+update_permutation_inv_avx512(uint32_t* data, uint32_t size, uint32_t controls, uint32_t targets)
+{
+	if (size < 16u || (targets & 15u) != 0u) {
+		update_permutation_inv_avx2(data, size, controls, targets);
+		return;
+	}
+
+	const inv_block_plan plan(16u, controls, targets);
+	const auto mask = static_cast<__mmask16>(plan.lane_mask);
+	for (auto chunk = 0u; chunk < size; chunk += 2u * plan.high) {
+		for (auto i = chunk; i < chunk + plan.high; i += 16u) {
+			if ((i & plan.block_controls) != plan.block_controls) {
+				continue;
+			}
+			const auto j = i ^ targets;
+			const auto a = _mm512_loadu_si512(data + i);
+			const auto b = _mm512_loadu_si512(data + j);
+			_mm512_storeu_si512(data + i, _mm512_mask_blend_epi32(mask, a, b));
+			_mm512_storeu_si512(data + j, _mm512_mask_blend_epi32(mask, b, a));
+		}
+	}
+}
+#pragma endregion
+#endif
+
+/*! \brief Returns the best instruction set supported by the CPU. */
+inline simd_level detect_simd_level()
+{
+#if TWEEDLEDUM_PERMUTATION_SIMD
+	static const auto level = []() {
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			return simd_level::avx512;
+		}
+		if (__builtin_cpu_supports("avx2")) {
+			return simd_level::avx2;
+		}
+		return simd_level::scalar;
+	}();
+	return level;
+#else
+	return simd_level::scalar;
+#endif
+}
+
+/*! \brief Returns the permutation update kernels for an instruction set.
+ *
+ * If the instruction set is not available in this build, the scalar kernels are returned.  The
+ * caller is responsible for checking that the CPU supports ``level`` (see `detect_simd_level`).
+ */
+inline permutation_update_kernels get_permutation_update_kernels(simd_level level)
+{
+#if TWEEDLEDUM_PERMUTATION_SIMD
+	switch (level) {
+	case simd_level::avx512:
+		return {update_permutation_avx512, update_permutation_inv_avx512};
+	case simd_level::avx2:
+		return {update_permutation_avx2, update_permutation_inv_avx2};
+	default:
+		break;
+	}
+#else
+	(void) level;
+#endif
+	return {update_permutation_scalar, update_permutation_inv_scalar};
+}
+
+/*! \brief Returns the permutation update kernels for the best instruction set of the CPU. */
+inline permutation_update_kernels const& get_permutation_update_kernels()
+{
+	static const auto kernels = get_permutation_update_kernels(detect_simd_level());
+	return kernels;
+}
+
+} // namespace tweedledum::detail
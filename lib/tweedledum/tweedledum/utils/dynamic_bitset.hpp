@@ -8,6 +8,7 @@
 #include <cassert>
 #include <memory>
 #include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace tweedledum {
@@ -213,6 +214,19 @@ public:
 		assert((other.bits_ = container_type()).empty());
 		other.num_bits_ = 0;
 	}
+
+	dynamic_bitset& operator=(dynamic_bitset const& other) = default;
+
+	dynamic_bitset& operator=(dynamic_bitset&& other)
+	{
+		if (this != &other) {
+			num_bits_ = other.num_bits_;
+			bits_ = std::move(other.bits_);
+			other.bits_.clear();
+			other.num_bits_ = 0;
+		}
+		return *this;
+	}
 #pragma endregion
 
 #pragma region Comparison
@@ -327,6 +341,13 @@ public:
 		return reference(bits_[block_index(position)], bit_index(position));
 	}
 
+	/*! \brief Returns the block at `index`, the bits past the size are zero. */
+	constexpr block_type block(size_type index) const
+	{
+		assert(index < num_blocks());
+		return bits_[index];
+	}
+
 	bool test(size_type position) const
 	{
 		assert(position < num_bits_);
@@ -376,7 +397,7 @@ public:
 	{
 		size_type count = 0;
 		for (auto block : bits_) {
-			count += __builtin_popcount(block);
+			count += __builtin_popcountll(block);
 		}
 		return count;
 	}
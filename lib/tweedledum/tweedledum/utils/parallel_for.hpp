@@ -0,0 +1,235 @@
+/*--------------------------------------------------------------------------------------------------
+| This file is distributed under the MIT License.
+| See accompanying file /LICENSE for details.
+| Author(s): Mathias Soeken
+*-------------------------------------------------------------------------------------------------*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tweedledum {
+
+/*! \brief Returns the number of threads to use for a requested number of threads.
+ *
+ * A value of 0 means to use as many threads as the hardware supports.
+ */
+inline uint32_t resolve_num_threads(uint32_t num_threads)
+{
+	if (num_threads == 0u) {
+		num_threads = std::thread::hardware_concurrency();
+	}
+	return std::max(num_threads, 1u);
+}
+
+/*! \brief Applies a function to all indexes in ``[0, size)`` using a pool of threads.
+ *
+ * The parameter ``fn`` must have the signature ``void(uint32_t index)``.  Indexes are handed out
+ * dynamically in chunks of ``chunk_size`` elements, such that threads that finish early pick up
+ * the remaining work.  If ``num_threads`` is 0, the hardware concurrency is used.  If only one
+ * thread is requested, ``fn`` is called in the calling thread.
+ *
+ * If ``fn`` throws, no further chunks are handed out and the first exception is rethrown after
+ * all threads have been joined.
+ */
+template<class Fn>
+void parallel_for(uint32_t size, Fn&& fn, uint32_t num_threads = 0u, uint32_t chunk_size = 1u)
+{
+	chunk_size = std::max(chunk_size, 1u);
+	num_threads = std::min(resolve_num_threads(num_threads), (size + chunk_size - 1) / chunk_size);
+	if (num_threads <= 1u) {
+		for (auto i = 0u; i < size; ++i) {
+			fn(i);
+		}
+		return;
+	}
+
+	std::atomic<uint32_t> next{0u};
+	std::atomic<bool> failed{false};
+	std::exception_ptr exception;
+	std::mutex exception_mutex;
+
+	auto worker = [&]() {
+		while (!failed) {
+			const auto begin = next.fetch_add(chunk_size);
+			if (begin >= size) {
+				return;
+			}
+			const auto end = std::min(size, begin + chunk_size);
+			try {
+				for (auto i = begin; i < end; ++i) {
+					fn(i);
+				}
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(exception_mutex);
+				if (!exception) {
+					exception = std::current_exception();
+				}
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for (auto i = 1u; i < num_threads; ++i) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+/*! \brief A pool of threads for repeated parallel loops.
+ *
+ * Unlike `parallel_for`, the threads are created once and are reused by every call to
+ * ``parallel_for``, which makes the pool suitable for many short parallel loops, e.g., inside the
+ * main loop of an algorithm.  Indexes are handed out dynamically in chunks, and the calling thread
+ * participates in the work.
+ */
+class thread_pool {
+public:
+	/*! \brief Creates a pool that runs loops on ``num_threads`` threads (0 means hardware
+	 * concurrency), including the calling thread. */
+	explicit thread_pool(uint32_t num_threads = 0u)
+	{
+		num_threads = resolve_num_threads(num_threads);
+		threads_.reserve(num_threads - 1);
+		for (auto i = 1u; i < num_threads; ++i) {
+			threads_.emplace_back([this]() { worker_loop(); });
+		}
+	}
+
+	~thread_pool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		start_cv_.notify_all();
+		for (auto& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	thread_pool(thread_pool const&) = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+
+	/*! \brief Returns the number of threads including the calling thread. */
+	uint32_t num_threads() const
+	{
+		return threads_.size() + 1u;
+	}
+
+	/*! \brief Calls ``fn(begin, end)`` for chunks of at most ``chunk_size`` indexes covering
+	 * ``[0, size)``.
+	 *
+	 * If ``fn`` throws, no further chunks are handed out and the first exception is rethrown after
+	 * all threads finished their current chunk.
+	 */
+	template<class Fn>
+	void parallel_for_chunks(uint32_t size, uint32_t chunk_size, Fn&& fn)
+	{
+		chunk_size = std::max(chunk_size, 1u);
+		if (threads_.empty() || size <= chunk_size) {
+			for (auto begin = 0u; begin < size; begin += chunk_size) {
+				fn(begin, std::min(size, begin + chunk_size));
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_ = [&fn](uint32_t begin, uint32_t end) { fn(begin, end); };
+			size_ = size;
+			chunk_size_ = chunk_size;
+			next_ = 0u;
+			failed_ = false;
+			exception_ = nullptr;
+			active_ = threads_.size();
+			++generation_;
+		}
+		start_cv_.notify_all();
+		run_chunks();
+
+		std::unique_lock<std::mutex> lock(mutex_);
+		done_cv_.wait(lock, [&]() { return active_ == 0u; });
+		job_ = nullptr;
+		if (exception_) {
+			std::rethrow_exception(exception_);
+		}
+	}
+
+private:
+	void worker_loop()
+	{
+		uint64_t generation = 0u;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				start_cv_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+				if (stop_) {
+					return;
+				}
+				generation = generation_;
+			}
+			run_chunks();
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (--active_ == 0u) {
+					done_cv_.notify_one();
+				}
+			}
+		}
+	}
+
+	void run_chunks()
+	{
+		while (!failed_) {
+			const auto begin = next_.fetch_add(chunk_size_);
+			if (begin >= size_) {
+				return;
+			}
+			try {
+				job_(begin, std::min(size_, begin + chunk_size_));
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(exception_mutex_);
+				if (!exception_) {
+					exception_ = std::current_exception();
+				}
+				failed_ = true;
+			}
+		}
+	}
+
+private:
+	std::vector<std::thread> threads_;
+	std::mutex mutex_;
+	std::condition_variable start_cv_;
+	std::condition_variable done_cv_;
+	bool stop_ = false;
+	uint64_t generation_ = 0u;
+	uint32_t active_ = 0u;
+
+	std::function<void(uint32_t, uint32_t)> job_;
+	uint32_t size_ = 0u;
+	uint32_t chunk_size_ = 1u;
+	std::atomic<uint32_t> next_{0u};
+	std::atomic<bool> failed_{false};
+	std::mutex exception_mutex_;
+	std::exception_ptr exception_;
+};
+
+} // namespace tweedledum
@@ -6,19 +6,93 @@
 #pragma once
 
 #include "angle.hpp"
+#include "dynamic_bitset.hpp"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <fmt/format.h>
 #include <iostream>
-#include <unordered_map>
+#include <iterator>
+#include <limits>
+#include <sparsepp/spp.h>
+#include <type_traits>
 #include <vector>
 
 namespace tweedledum {
 
-/*! \brief
+/*! \brief Operations on parity terms.
+ *
+ * A parity term is either an unsigned integer or a `dynamic_bitset`, in which the i-th bit is set
+ * if the i-th qubit is part of the parity.  Bitset terms must have one bit per qubit.
  */
+template<typename Term>
+struct parity_term_traits {
+	static_assert(std::is_integral<Term>::value && std::is_unsigned<Term>::value,
+	              "Unsigned integral type or dynamic_bitset required.");
+
+	/*! \brief Maximum number of qubits that a term can refer to. */
+	static constexpr uint32_t max_num_qubits = std::numeric_limits<Term>::digits;
+
+	/*! \brief Returns the term that only contains qubit `index`. */
+	static Term unit(uint32_t num_qubits, uint32_t index)
+	{
+		(void) num_qubits;
+		return Term(1) << index;
+	}
+
+	/*! \brief Checks whether qubit `index` is part of the term. */
+	static bool contains(Term term, uint32_t index)
+	{
+		return (term >> index) & 1u;
+	}
+
+	using hash = spp::spp_hash<Term>;
+};
+
+template<typename WordType>
+struct parity_term_traits<dynamic_bitset<WordType>> {
+	using term_type = dynamic_bitset<WordType>;
+
+	static constexpr uint32_t max_num_qubits = std::numeric_limits<uint32_t>::max();
+
+	static term_type unit(uint32_t num_qubits, uint32_t index)
+	{
+		term_type term(num_qubits);
+		term[index] = 1;
+		return term;
+	}
+
+	static bool contains(term_type const& term, uint32_t index)
+	{
+		return term[index];
+	}
+
+	struct hash {
+		std::size_t operator()(term_type const& term) const
+		{
+			std::size_t seed = term.size();
+			for (auto i = 0u; i < term.num_blocks(); ++i) {
+				spp::hash_combine(seed, term.block(i));
+			}
+			return seed;
+		}
+	};
+};
+
+/*! \brief Parity terms with their rotation angles.
+ *
+ * The terms are stored in an open-addressing hash table, such that adding and extracting a term
+ * does not allocate a node.  The template parameter determines the representation of a term (see
+ * `parity_term_traits`): `uint32_t` (default) and `uint64_t` allow up to 32 and 64 qubits, and
+ * `dynamic_bitset` an arbitrary number of qubits.
+ */
+template<typename Term = uint32_t>
 class parity_terms {
 public:
+	using term_type = Term;
+	using traits = parity_term_traits<Term>;
+
 #pragma region Types and constructors
 	parity_terms()
 	{}
@@ -44,11 +118,17 @@ public:
 #pragma endregion
 
 #pragma region Modifiers
+	/*! \brief Reserves space for `num_terms` terms. */
+	void reserve(std::size_t num_terms)
+	{
+		term_to_angle_.reserve(num_terms);
+	}
+
 	/*! \brief Add parity term.
 	 *
 	 * If the term already exist it increments the rotation angle
 	 */
-	void add_term(uint32_t term, angle rotation_angle)
+	void add_term(term_type const& term, angle rotation_angle)
 	{
 		assert(rotation_angle != 0.0);
 		auto search = term_to_angle_.find(term);
@@ -59,19 +139,34 @@ public:
 		}
 	}
 
+	/*! \brief Add parity terms from a range of (term, angle) pairs. */
+	template<typename Iterator>
+	void add_terms(Iterator begin, Iterator end)
+	{
+		if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+		                  typename std::iterator_traits<Iterator>::iterator_category>) {
+			reserve(num_terms() + std::distance(begin, end));
+		}
+		for (; begin != end; ++begin) {
+			add_term(begin->first, begin->second);
+		}
+	}
+
 	/*! \brief Extract parity term. */
-	auto extract_term(uint32_t term)
+	angle extract_term(term_type const& term)
 	{
-		auto node_handle = term_to_angle_.extract(term);
-		if (node_handle.empty()) {
+		auto search = term_to_angle_.find(term);
+		if (search == term_to_angle_.end()) {
 			return angle(0.0);
 		}
-		return node_handle.mapped();
+		auto const rotation_angle = search->second;
+		term_to_angle_.erase(search);
+		return rotation_angle;
 	}
 #pragma endregion
 
 private:
-	std::unordered_map<uint32_t, angle> term_to_angle_;
+	spp::sparse_hash_map<term_type, angle, typename traits::hash> term_to_angle_;
 };
 
 } // namespace tweedledum
@@ -26,52 +26,39 @@ def _to_qiskit(self, circuit=None, with_classical_register=False):
   # collect all qubits from all quantum registers
   qr = [q for reg in circuit.qregs for q in reg]
 
-  for g in self.gates:
-    if g.kind == gate.gate_type.pauli_x:
-      for t in g.targets:
-        circuit.x(qr[t])
+  # gates are lowered in C++ into instructions with positive controls and
+  # single targets, such that each instruction maps to one Qiskit gate
+  table = self.instructions()
+  ops = memoryview(table["ops"]).tolist()
+  offsets = memoryview(table["qubit_offsets"]).tolist()
+  qubits = [qr[q] for q in memoryview(table["qubits"]).tolist()]
+  params = memoryview(table["params"]).tolist()
 
-    elif g.kind == gate.gate_type.hadamard:
-      for t in g.targets:
-        circuit.h(qr[t])
+  gt = gate.gate_type
+  single = {int(gt.hadamard): circuit.h, int(gt.pauli_x): circuit.x,
+            int(gt.pauli_y): circuit.y, int(gt.pauli_z): circuit.z,
+            int(gt.phase): circuit.s, int(gt.phase_dagger): circuit.sdg,
+            int(gt.t): circuit.t, int(gt.t_dagger): circuit.tdg}
+  rotation = {int(gt.rotation_x): circuit.rx, int(gt.rotation_y): circuit.ry,
+              int(gt.rotation_z): circuit.rz}
+  cx, cz, mcx = int(gt.cx), int(gt.cz), int(gt.mcx)
 
-    elif g.kind == gate.gate_type.rotation_z:
-      for t in g.targets:
-        circuit.rz(g.angle, qr[t])
-
-    elif g.kind == gate.gate_type.cx:
-      ctrl = g.controls[0]
-      for t in g.targets:
-        circuit.cx(qr[int(ctrl)], qr[t])
-      if not bool(ctrl):
-        circuit.x(qr[t])
-
-    elif g.kind == gate.gate_type.mcx:
-      ctls = g.controls
-
-      # only at most 2 controls and no negative controls
-      if len(ctls) > 2: raise Exception("X gates cannot have more than 2 controls")
-
-      negs = [qr[int(q)] for q in ctls if not bool(q)]
-      ctls = [qr[int(q)] for q in ctls]
-      tgts = [qr[q] for q in g.targets]
-
-      for t in tgts[1:]:
-        circuit.cx(tgts[0], t)
-      for n in negs:
-        circuit.x(n)
-      if len(ctls) == 0:
-        circuit.x(tgts[0])
-      elif len(ctls) == 1:
-        circuit.cx(ctls[0], tgts[0])
-      else:
-        circuit.ccx(ctls[0], ctls[1], tgts[0])
-      for n in negs:
-        circuit.x(n)
-      for t in tgts[1:]:
-        circuit.cx(tgts[0], t)
+  for i, op in enumerate(ops):
+    begin, end = offsets[i], offsets[i + 1]
+    if op in single:
+      single[op](qubits[begin])
+    elif op in rotation:
+      rotation[op](params[i], qubits[begin])
+    elif op == cx:
+      circuit.cx(qubits[begin], qubits[begin + 1])
+    elif op == cz:
+      circuit.cz(qubits[begin], qubits[begin + 1])
+    elif op == mcx and end - begin == 3:
+      circuit.ccx(qubits[begin], qubits[begin + 1], qubits[begin + 2])
+    elif op == mcx:
+      circuit.mcx(qubits[begin:end - 1], qubits[end - 1])
     else:
-      raise Exception(f"Unsupported gate type {g.kind}")
+      raise Exception(f"Unsupported gate type {gt(op)}")
 
   return circuit
 
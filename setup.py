@@ -15,6 +15,18 @@ class get_pybind_include(object):
         import pybind11
         return pybind11.get_include(self.user)
 
+define_macros = [
+  ('FMT_HEADER_ONLY', '1'),
+  ('DISABLE_NAUTY', '1'),
+  ('LIN64', '1'),
+  ('ABC_NAMESPACE', 'pabc'),
+  ('ABC_NO_USE_READLINE', '1')
+]
+
+# store circuits with caterpillar::compact_stg_gate (saves memory for large circuits)
+if os.environ.get('REVKIT_COMPACT_NETLIST', '0') not in ('', '0'):
+  define_macros.append(('REVKIT_COMPACT_NETLIST', '1'))
+
 ext_modules = [
   Extension(
     '_revkit',
@@ -37,13 +49,7 @@ ext_modules = [
       os.path.join(base_path, 'lib', 'sparsepp'),
       os.path.join(base_path, 'lib', 'tweedledum')
     ],
-    define_macros=[
-      ('FMT_HEADER_ONLY', '1'),
-      ('DISABLE_NAUTY', '1'),
-      ('LIN64', '1'),
-      ('ABC_NAMESPACE', 'pabc'),
-      ('ABC_NO_USE_READLINE', '1')
-    ],
+    define_macros=define_macros,
     language='c++'
   )
 ]
@@ -54,13 +60,17 @@ class BuildExt(build_ext):
   def build_extensions(self):
     ct = self.compiler.compiler_type
     opts = []
+    link_opts = []
     if ct == 'unix':
       opts.append('-std=c++17')
       opts.append('-Wno-unknown-pragmas')
+      opts.append('-pthread')
+      link_opts.append('-pthread')
     else:
       opts.append('/std:c++17')
     for ext in self.extensions:
       ext.extra_compile_args = opts
+      ext.extra_link_args = link_opts
     build_ext.build_extensions(self)
 
 class PyTest(TestCommand):
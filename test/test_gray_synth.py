@@ -0,0 +1,33 @@
+import revkit
+import pytest
+from math import pi
+
+def test_gray_synth_synthesizes_controlled_s():
+  net = revkit.gray_synth(("01", pi / 4), ("10", pi / 4), ("11", -pi / 4))
+  assert net.num_qubits == 2
+  assert net.num_gates > 0
+
+def test_gray_synth_more_than_32_variables():
+  for num_vars in [40, 70]:
+    terms = [("1" * num_vars, pi / 4), ("0" * (num_vars - 1) + "1", pi / 8), ("1" + "0" * (num_vars - 1), pi / 8)]
+    net = revkit.gray_synth(*terms)
+    assert net.num_qubits == num_vars
+
+def test_gray_synth_rejects_long_terms():
+  with pytest.raises(RuntimeError):
+    revkit.gray_synth(("01", pi / 4), ("011", pi / 4))
+
+def test_gray_synth_from_buffers():
+  from array import array
+  net = revkit.gray_synth(array('I', [0b10, 0b01, 0b11]), array('d', [pi / 4, pi / 4, -pi / 4]), 2)
+  ref = revkit.gray_synth(("01", pi / 4), ("10", pi / 4), ("11", -pi / 4))
+  assert net.num_qubits == 2
+  assert net.num_gates == ref.num_gates
+
+  net = revkit.gray_synth(terms=array('Q', [1 << 39, 1, (1 << 40) - 1]), angles=array('d', [pi / 8, pi / 8, pi / 4]), num_vars=40)
+  assert net.num_qubits == 40
+
+  with pytest.raises(RuntimeError):
+    revkit.gray_synth(array('I', [0b100]), array('d', [pi / 4]), 2)
+  with pytest.raises(RuntimeError):
+    revkit.gray_synth(array('I', [0b01, 0b10]), array('d', [pi / 4]), 2)
@@ -0,0 +1,117 @@
+import revkit
+import pytest
+
+verilog = """module top(a, b, c, y);
+input a, b, c;
+output y;
+wire w;
+assign w = a & b;
+assign y = w ^ c;
+endmodule
+"""
+
+def test_lhrs_from_string():
+  circ, stats = revkit.lhrs_from_string(verilog, revkit.logic_network_format.verilog)
+  assert len(stats["input_indexes"]) == 3
+  assert len(stats["output_indexes"]) == 1
+  assert circ.num_gates > 0
+
+def test_lhrs_from_bytes():
+  circ1, _ = revkit.lhrs_from_string(verilog, revkit.logic_network_format.verilog)
+  circ2, _ = revkit.lhrs_from_bytes(verilog.encode(), revkit.logic_network_format.verilog)
+  assert circ1.num_gates == circ2.num_gates
+  assert circ1.num_qubits == circ2.num_qubits
+
+def test_lhrs_from_bytes_rejects_strided_buffer():
+  data = memoryview((verilog + verilog).encode())[::2]
+  with pytest.raises(ValueError):
+    revkit.lhrs_from_bytes(data, revkit.logic_network_format.verilog)
+
+def _gates(circ):
+  return {name: list(memoryview(array)) for name, array in circ.gate_arrays().items()}
+
+def test_lhrs_parallel_luts():
+  bench = "INPUT(a)\nINPUT(b)\nINPUT(c)\nINPUT(d)\nOUTPUT(y)\nx = LUT 0xe8 (a, b, c)\nw = LUT 0x6 (c, d)\ny = LUT 0x1e (x, w, a)\n"
+  for lut_synthesis in [revkit.oracle_synth_type.spectrum, revkit.oracle_synth_type.pprm, revkit.oracle_synth_type.pkrm]:
+    # with one thread, LUTs are synthesized directly into the circuit
+    circ1, _ = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, network_type=revkit.lhrs_network_type.klut, lut_synthesis=lut_synthesis)
+    circ2, _ = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, network_type=revkit.lhrs_network_type.klut, lut_synthesis=lut_synthesis, num_threads=4)
+    assert circ1.num_qubits == circ2.num_qubits
+    assert _gates(circ1) == _gates(circ2)
+
+def test_lhrs_cache_luts():
+  bench = "INPUT(a)\nINPUT(b)\nINPUT(c)\nINPUT(d)\nOUTPUT(y)\nOUTPUT(z)\nx = LUT 0xe8 (a, b, c)\nw = LUT 0xd4 (c, d, a)\nv = LUT 0x17 (b, d, c)\ny = LUT 0x96 (x, w, v)\nz = LUT 0x69 (x, d, a)\n"
+  circ, stats = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, network_type=revkit.lhrs_network_type.klut, lut_synthesis=revkit.oracle_synth_type.pkrm, cache_luts=True)
+  assert stats["stg_cache_hits"] == [5]
+  assert stats["stg_cache_misses"] == [2]
+  assert circ.num_gates > 0
+  _, stats = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, network_type=revkit.lhrs_network_type.klut)
+  assert "stg_cache_hits" not in stats
+
+def test_lhrs_pkrm_cache_stats():
+  bench = "INPUT(a)\nINPUT(b)\nINPUT(c)\nINPUT(d)\nOUTPUT(y)\nOUTPUT(z)\nx = LUT 0xe8 (a, b, c)\nw = LUT 0xd4 (c, d, a)\nv = LUT 0x17 (b, d, c)\ny = LUT 0x96 (x, w, v)\nz = LUT 0x69 (x, d, a)\n"
+  args = dict(network_type=revkit.lhrs_network_type.klut, lut_synthesis=revkit.oracle_synth_type.pkrm)
+  _, stats = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, **args)
+  assert "pkrm_cache_hits" not in stats
+  _, stats1 = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, cache_luts=True, **args)
+  assert stats1["pkrm_cache_hits"][0] > 0
+  assert stats1["pkrm_cache_misses"][0] > 0
+  assert stats1["pkrm_cache_evictions"] == [0]
+  # each run uses its own cache
+  _, stats2 = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, cache_luts=True, **args)
+  assert stats2["pkrm_cache_hits"] == stats1["pkrm_cache_hits"]
+  assert stats2["pkrm_cache_misses"] == stats1["pkrm_cache_misses"]
+
+def test_lhrs_stream(tmp_path):
+  filename = tmp_path / "top.v"
+  filename.write_text(verilog)
+  circ, _ = revkit.lhrs(str(filename))
+
+  output = tmp_path / "top.quil"
+  stats = revkit.lhrs_stream(str(filename), str(output), revkit.circuit_format.quil)
+  assert len(stats["input_indexes"]) == 3
+  assert output.read_text() == circ.to_quil()
+
+  chunks = []
+  revkit.lhrs_stream(str(filename), chunks.append, revkit.circuit_format.binary)
+  output = tmp_path / "top.bin"
+  output.write_bytes(b"".join(chunks))
+  assert revkit.netlist.load(str(output)).to_qasm() == circ.to_qasm()
+
+def test_lhrs_iter_code(tmp_path):
+  # ancillae are added after the first gates
+  circ, _ = revkit.lhrs_from_string(verilog, revkit.logic_network_format.verilog)
+  assert "".join(circ.iter_qasm(1)) == circ.to_qasm()
+  assert "".join(circ.iter_quil(1)) == circ.to_quil()
+  circ.write_qasm(str(tmp_path / "top.qasm"))
+  assert (tmp_path / "top.qasm").read_text() == circ.to_qasm()
+
+def test_lhrs_cannot_open(tmp_path):
+  with pytest.raises(RuntimeError, match="cannot open file"):
+    revkit.lhrs(str(tmp_path / "missing.v"))
+
+def test_lhrs_stream_cannot_open(tmp_path):
+  chunks = []
+  with pytest.raises(RuntimeError, match="cannot open file"):
+    revkit.lhrs_stream(str(tmp_path / "missing.v"), chunks.append)
+  assert chunks == []
+  with pytest.raises(RuntimeError, match="cannot open file"):
+    revkit.lhrs_stream(str(tmp_path / "missing.v"), str(tmp_path / "top.qasm"))
+
+  filename = tmp_path / "top.v"
+  filename.write_text(verilog)
+  with pytest.raises(RuntimeError, match="cannot open file"):
+    revkit.lhrs_stream(str(filename), str(tmp_path / "missing" / "top.qasm"))
+
+def test_lhrs_pebbling_portfolio():
+  bench = "INPUT(a)\nINPUT(b)\nINPUT(c)\nINPUT(d)\nOUTPUT(y)\nx = LUT 0xe8 (a, b, c)\nw = LUT 0x6 (c, d)\nv = LUT 0x8 (x, w)\ny = LUT 0x1e (v, w, a)\n"
+  args = dict(network_type=revkit.lhrs_network_type.klut, strategy=revkit.mapping_strategy.pebbling, lut_synthesis=revkit.oracle_synth_type.pkrm)
+  circ1, stats1 = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, **args)
+  circ2, stats2 = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, pebbling_num_threads=2, pebbling_time_limit=10, **args)
+  assert circ2.num_qubits <= circ1.num_qubits
+  tts1 = circ1.simulate(stats1["input_indexes"], stats1["output_indexes"])
+  tts2 = circ2.simulate(stats2["input_indexes"], stats2["output_indexes"])
+  assert tts1 == tts2
+  # LUT synthesis threads do not enable the portfolio
+  circ3, _ = revkit.lhrs_from_string(bench, revkit.logic_network_format.bench, num_threads=4, **args)
+  assert _gates(circ3) == _gates(circ1)
@@ -1,4 +1,4 @@
-from revkit import netlist, tbs
+from revkit import gate, netlist, tbs
 import pytest
 
 def test_netlist():
@@ -7,3 +7,199 @@ def test_netlist():
   assert 3 == circ.num_gates
   assert circ.to_quil() == "CNOT 1 0\nCNOT 0 1\nCNOT 1 0\n"
   assert circ.to_qasm() == 'OPENQASM 2.0;\ninclude "qelib1.inc";\nqreg q[2];\ncreg c[2];\ncx q[1],q[0];\ncx q[0],q[1];\ncx q[1],q[0];\n'
+
+def test_gate_arrays():
+  circ = tbs([0, 2, 1, 3])
+  arrays = circ.gate_arrays()
+  assert list(memoryview(arrays["kinds"])) == [int(gate.gate_type.mcx)] * 3
+  assert list(memoryview(arrays["control_offsets"])) == [0, 1, 2, 3]
+  assert list(memoryview(arrays["controls"])) == [1, 0, 1]
+  assert list(memoryview(arrays["complemented"])) == [0, 0, 0]
+  assert list(memoryview(arrays["target_offsets"])) == [0, 1, 2, 3]
+  assert list(memoryview(arrays["targets"])) == [0, 1, 0]
+
+def test_instructions():
+  circ = tbs([0, 2, 1, 3])
+  table = circ.instructions()
+  assert list(memoryview(table["ops"])) == [int(gate.gate_type.cx)] * 3
+  assert list(memoryview(table["qubit_offsets"])) == [0, 2, 4, 6]
+  assert list(memoryview(table["qubits"])) == [1, 0, 0, 1, 1, 0]
+  assert list(memoryview(table["params"])) == [0.0] * 3
+
+  table = tbs([0, 2, 3, 5, 7, 1, 4, 6]).instructions()
+  ops = list(memoryview(table["ops"]))
+  offsets = list(memoryview(table["qubit_offsets"]))
+  assert len(offsets) == len(ops) + 1
+  sizes = {int(gate.gate_type.pauli_x): 1, int(gate.gate_type.cx): 2, int(gate.gate_type.mcx): 3}
+  assert all(offsets[i + 1] - offsets[i] == sizes[op] for i, op in enumerate(ops))
+
+def _write_binary(filename, num_qubits, gates):
+  import struct
+  # gates are (gate type, controls, targets) with at most 5 qubit literals each
+  records = b""
+  for kind, controls, targets in gates:
+    literals = controls + [t << 1 for t in targets]
+    records += struct.pack("<BBHHHI5I", int(kind), 0, len(controls), len(targets), 1, 0, *(literals + [0] * (5 - len(literals))))
+  labels = ["q{}".format(i) for i in range(num_qubits)]
+  ends = [sum(len(l) for l in labels[:i + 1]) for i in range(num_qubits)]
+  labels = struct.pack("<{}I".format(num_qubits), *ends) + "".join(labels).encode()
+  labels += b"\0" * (-len(labels) % 8)
+  angles = struct.pack("<IId", 4, 0, 0.0)
+  rewiring = struct.pack("<{}I".format(num_qubits), *range(num_qubits))
+  rewiring += b"\0" * (-len(rewiring) % 8)
+  labels_offset = 16 + len(records)
+  angles_offset = labels_offset + len(labels)
+  functions_offset = angles_offset + len(angles)
+  trailer = struct.pack("<6Q4I", len(gates), len(gates), labels_offset, angles_offset, functions_offset, functions_offset, num_qubits, 1, 0, 0)
+  filename.write_bytes(b"TWDLCIRC" + struct.pack("<II", 1, 32) + records + labels + angles + rewiring + trailer + b"TWDLCIRC")
+
+def _simulate_instructions(table, num_qubits, basis):
+  from math import sqrt
+  ops = list(memoryview(table["ops"]))
+  offsets = list(memoryview(table["qubit_offsets"]))
+  qubits = list(memoryview(table["qubits"]))
+  state = [0.0] * (1 << num_qubits)
+  state[basis] = 1.0
+  for i, op in enumerate(ops):
+    *controls, target = qubits[offsets[i]:offsets[i + 1]]
+    mask = 1 << target
+    new_state = [0.0] * len(state)
+    for b, amplitude in enumerate(state):
+      if not all((b >> c) & 1 for c in controls):
+        new_state[b] += amplitude
+      elif op in [int(gate.gate_type.pauli_x), int(gate.gate_type.cx), int(gate.gate_type.mcx)]:
+        new_state[b ^ mask] += amplitude
+      elif op in [int(gate.gate_type.pauli_z), int(gate.gate_type.cz)]:
+        new_state[b] += -amplitude if b & mask else amplitude
+      elif op == int(gate.gate_type.hadamard):
+        new_state[b & ~mask] += amplitude / sqrt(2)
+        new_state[b | mask] += (-amplitude if b & mask else amplitude) / sqrt(2)
+      else:
+        assert False
+    state = new_state
+  return state
+
+def test_instructions_multiple_targets(tmp_path):
+  # mcz and mcx with two controls (the second one negated) on several targets
+  filename = tmp_path / "circ.bin"
+  _write_binary(filename, 5, [(gate.gate_type.mcz, [0 << 1, 1 << 1 | 1], [2, 3, 4]),
+                              (gate.gate_type.mcx, [0 << 1, 1 << 1], [2, 3])])
+  circ = netlist.load(str(filename))
+  table = circ.instructions()
+  for basis in range(32):
+    bit = lambda i: (basis >> i) & 1
+    phase = -1.0 if bit(0) and not bit(1) and bit(2) ^ bit(3) ^ bit(4) else 1.0
+    output = basis ^ 0b01100 if bit(0) and bit(1) else basis
+    state = _simulate_instructions(table, 5, basis)
+    assert all(abs(a - (phase if b == output else 0.0)) < 1e-9 for b, a in enumerate(state))
+
+def test_simulate():
+  perm = [0, 2, 3, 5, 7, 1, 4, 6]
+  circ = tbs(perm)
+  tts = circ.simulate([0, 1, 2], [0, 1, 2], num_threads=2)
+  for o, tt in enumerate(tts):
+    assert str(tt) == "".join(str((perm[j] >> o) & 1) for j in reversed(range(8)))
+
+  inputs, outputs = circ.simulate_random([0, 1, 2], [0, 1, 2], num_vars=8, seed=1)
+  assert len(inputs) == len(outputs) == 3
+  copy = netlist.from_qasm(circ.to_qasm())
+  assert copy.simulate_random([0, 1, 2], [0, 1, 2], num_vars=8, seed=1) == (inputs, outputs)
+
+def test_to_permutation():
+  perm = [0, 2, 3, 5, 7, 1, 4, 6]
+  circ = tbs(perm)
+  assert circ.to_permutation() == perm
+  assert circ.to_permutation(num_threads=2) == perm
+  assert circ.implements_permutation(perm)
+  assert not circ.implements_permutation([0, 2, 3, 5, 7, 1, 6, 4])
+  assert not circ.implements_permutation([0, 1, 2, 3])
+
+def test_simulate_invalid_qubits():
+  circ = tbs([0, 2, 3, 5, 7, 1, 4, 6])
+  with pytest.raises(IndexError):
+    circ.simulate([0, 1, 3], [0, 1, 2])
+  with pytest.raises(IndexError):
+    circ.simulate([0, 1, 2], [0, 1, 2**31])
+  with pytest.raises(ValueError):
+    circ.simulate([0, 1, 1], [0, 1, 2])
+  with pytest.raises(IndexError):
+    circ.simulate_random([0, 1, 3], [0, 1, 2])
+  with pytest.raises(IndexError):
+    circ.simulate_random([0, 1, 2], [3])
+  with pytest.raises(ValueError):
+    circ.simulate_random([2, 2], [0])
+
+def test_save_load(tmp_path):
+  circ = tbs([0, 2, 3, 5, 7, 1, 4, 6])
+  filename = str(tmp_path / "circ.bin")
+  circ.save(filename)
+  loaded = netlist.load(filename)
+  assert loaded.num_qubits == circ.num_qubits
+  assert loaded.num_gates == circ.num_gates
+  assert loaded.to_qasm() == circ.to_qasm()
+
+def test_load_invalid(tmp_path):
+  filename = tmp_path / "invalid.bin"
+  filename.write_bytes(b"OPENQASM 2.0;\n")
+  with pytest.raises(RuntimeError):
+    netlist.load(str(filename))
+
+  # meta operations, and the operation of function gates without a function
+  num_defined_ops = int(gate.gate_type.mcz) + 1
+  for kind in [gate.gate_type.undefined, gate.gate_type.input, gate.gate_type.output, num_defined_ops]:
+    _write_binary(filename, 2, [(kind, [], [0])])
+    with pytest.raises(RuntimeError, match="bad gate record"):
+      netlist.load(str(filename))
+
+def test_load_corrupted(tmp_path):
+  import struct
+  circ = tbs([0, 2, 3, 5, 7, 1, 4, 6])
+  filename = tmp_path / "circ.bin"
+  circ.save(str(filename))
+  data = filename.read_bytes()
+  trailer_size = 72
+
+  def set_trailer_field(index, value):
+    offset = len(data) - trailer_size + 8 * index
+    return data[:offset] + struct.pack("<Q", value) + data[offset + 8:]
+
+  corrupted = [
+    data[:-8],                               # truncated trailer
+    data[:16] + data[-trailer_size:],        # truncated sections
+    set_trailer_field(1, 2**60),             # number of records
+    set_trailer_field(3, 2**64 - 8),         # angles offset
+    set_trailer_field(4, 2**64 - 8),         # functions offset
+    set_trailer_field(5, 2**64 - 8),         # rewiring offset
+  ]
+  for index, content in enumerate(corrupted):
+    filename = tmp_path / "corrupted{}.bin".format(index)
+    filename.write_bytes(content)
+    with pytest.raises(RuntimeError, match="invalid binary circuit"):
+      netlist.load(str(filename))
+
+def test_from_qasm(tmp_path):
+  circ = tbs([0, 2, 3, 5, 7, 1, 4, 6])
+  assert netlist.from_qasm(circ.to_qasm()).to_qasm() == circ.to_qasm()
+  filename = tmp_path / "circ.qasm"
+  filename.write_text(circ.to_qasm())
+  assert netlist.load_qasm(str(filename)).num_gates == circ.num_gates
+
+def test_from_qasm_expressions():
+  expressions = {"-2^2": -4.0, "2^-1": 0.5, "2^3^2": 512.0, "-2*3": -6.0, "2^2*3": 12.0, "--2^2": 4.0}
+  for expression, value in expressions.items():
+    circ = netlist.from_qasm("qreg q[1];\nrz({}) q[0];\n".format(expression))
+    assert list(memoryview(circ.gate_arrays()["angles"])) == [value]
+
+def test_from_qasm_invalid():
+  with pytest.raises(RuntimeError, match="qasm:2"):
+    netlist.from_qasm("qreg q[2];\ncx q[0], q[0];\n")
+
+def test_write_and_iter_code(tmp_path):
+  circ = tbs([0, 2, 3, 5, 7, 1, 4, 6])
+  assert "".join(circ.iter_qasm(16)) == circ.to_qasm()
+  assert "".join(circ.iter_quil(16)) == circ.to_quil()
+  assert len(list(circ.iter_qasm())) == 1
+  circ.write_qasm(str(tmp_path / "circ.qasm"))
+  assert (tmp_path / "circ.qasm").read_text() == circ.to_qasm()
+  circ.write_quil(str(tmp_path / "circ.quil"))
+  assert (tmp_path / "circ.quil").read_text() == circ.to_quil()
@@ -10,3 +10,10 @@ def test_tbs_synthesizes_swap():
   assert [c.index for c in g[0].controls] == [1]
   assert g[0].targets == [0]
   assert g[0].kind == revkit.gate.gate_type.mcx
+
+def test_tbs_batch():
+  perms = [[0, 2, 1, 3], [0, 1, 2, 3], [1, 0, 3, 2]]
+  nets = revkit.tbs_batch(perms, num_threads=2)
+  assert len(nets) == 3
+  for net, perm in zip(nets, perms):
+    assert net.num_gates == revkit.tbs(perm).num_gates